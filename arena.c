@@ -0,0 +1,8 @@
+#include "arena.h"
+
+void *ArenaTake(arena_t *arena, size_t size)
+{
+    void *block = arena->base == NULL ? NULL : arena->base + arena->used;
+    arena->used += (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    return block;
+}
@@ -0,0 +1,19 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_ALIGN 32 // every block is aligned for avx loads
+
+// bump allocator over memory someone else owns. with a NULL base it only adds up the sizes,
+// so the same code can measure a layout and then place it
+typedef struct arena_t
+{
+    unsigned char *base;
+    size_t used;
+} arena_t;
+
+// next size bytes rounded up to ARENA_ALIGN, NULL while measuring
+void *ArenaTake(arena_t *arena, size_t size);
+
+#endif
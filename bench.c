@@ -0,0 +1,403 @@
+// scripted scenarios through the simulation's spawn, integration and collision code, reported as json
+// usage: ./bench [--ticks n] [--threads n] [--repeats n] [--only name] [--json file] [--baseline file]
+//   [--threshold percent]
+// --ticks measures n ticks of every scenario instead of each one's own count, after a fifth as many warm up ticks
+// --threads 0 uses one thread per core, 1 stays on the calling thread
+// --repeats runs every scenario n times (default 3) and keeps the fastest, one run alone is often 15% off
+// --only runs the scenarios whose name contains name
+// --json writes the report there instead of stdout. a report is also what --baseline reads, so keep one from a
+//   known good build, e.g. ./bench --json bench_baseline.json
+// --baseline compares against such a report and exits 2 if any scenario's ticks/s fell, or its peak memory grew,
+//   by more than --threshold percent (default 10, must be above 0). numbers only compare on the machine they were
+//   taken on. a baseline entry that is not above 0 fails the run
+// every scenario runs in a child process of its own, so peak memory is its alone
+#include "game.h"
+#include "jobs.h"
+#include "kernels.h"
+#include "rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+const float defaultThreshold = 10; // percent
+const int defaultRepeats = 3;
+const float immortal = 1e9f;       // player hp, no scenario may end because the ship died
+const int stormRadius = 400;       // storm asteroids are dropped this close to the ship
+
+// what a scenario keeps the world at, checked before every tick
+typedef struct scenario_t
+{
+    const char *name;
+    long ticks; // measured
+    int asteroids;
+    int bullets;
+    int chunks; // a chunked field of fieldAsteroids, 0 for the classic screen
+    int fieldAsteroids;
+    void (*tick)(world_t *world, const struct scenario_t *scenario, long tick, unsigned int *input);
+} scenario_t;
+
+typedef struct bench_result_t
+{
+    bool ok;
+    long ticks;
+    double ticksPerSecond;
+    double entities;        // alive bullets and asteroids, averaged over the measured ticks
+    double nsPerEntity[3];  // spawn, integration, collision
+    long peakMemoryKb;
+} bench_result_t;
+
+static const profile_phase_e benchPhases[3] = {phaseSpawn, phaseIntegration, phaseCollision};
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static random_block_t BenchRandom(const world_t *world, uint32_t id)
+{
+    return RandomBlock(RandomKey(world->config.seed, randomStreamBench), id, (uint32_t)world->tick, 0);
+}
+
+// anywhere on the screen, any heading
+static void ScatterOnScreen(world_t *world, int count, float size)
+{
+    for (int n = 0; world->asteroid.pool.count < count; n++)
+    {
+        random_block_t random = BenchRandom(world, (uint32_t)n);
+        float radius = size > 0 ? size : random.word[0] % (asteroidMaxSize - asteroidMinSize + 1) + asteroidMinSize;
+        Vector2 center = {random.word[1] % screenWidth, random.word[2] % screenHeight};
+        if (SpawnAsteroid(world, center, radius, random.word[3]) == -1)
+            return;
+    }
+}
+
+// the bullets the player's gun does not keep in the air come in from random spots on the screen
+static void TopUpBullets(world_t *world, int count)
+{
+    for (int n = 0; world->bullet.pool.count < count; n++)
+    {
+        random_block_t random = BenchRandom(world, (uint32_t)(n + (1 << 24)));
+        Vector2 at = {random.word[0] % screenWidth, random.word[1] % screenHeight};
+        int before = world->bullet.pool.count;
+        SpawnBullet(&world->bullet, random.word[2], at, bulletSpeed * world->tickScale);
+        if (world->bullet.pool.count == before)
+            return;
+    }
+}
+
+// full auto while spinning, the field topped up from the screen edges
+static void FireTick(world_t *world, const scenario_t *scenario, long tick, unsigned int *input)
+{
+    if (tick == 0)
+        ScatterOnScreen(world, scenario->asteroids, 0); // a full screen from the start, not just the edges
+    world->fireCooldown = 0;
+    while (world->asteroid.pool.count < scenario->asteroids && SpawnRandomAsteroid(world))
+        ;
+    TopUpBullets(world, scenario->bullets);
+    *input = inputFire | inputRight;
+}
+
+// the largest asteroids shot down to the smallest, a fresh batch whenever most of the pieces are gone
+static void CascadeTick(world_t *world, const scenario_t *scenario, long tick, unsigned int *input)
+{
+    (void)tick;
+    world->fireCooldown = 0;
+    if (world->asteroid.pool.count < scenario->asteroids / 4)
+        ScatterOnScreen(world, scenario->asteroids, asteroidMaxSize);
+    TopUpBullets(world, scenario->bullets);
+    *input = inputFire | inputLeft;
+}
+
+// nobody at the controls, the field drifts and the timer wheel moves parked asteroids in and out
+static void IdleTick(world_t *world, const scenario_t *scenario, long tick, unsigned int *input)
+{
+    (void)world;
+    (void)scenario;
+    (void)tick;
+    *input = 0;
+}
+
+// the ship circling through a swarm packed around it, never invincible so every tick tests it for a hit
+static void StormTick(world_t *world, const scenario_t *scenario, long tick, unsigned int *input)
+{
+    world->playerIsInvincible = false;
+    for (int n = 0; world->asteroid.pool.count < scenario->asteroids; n++)
+    {
+        random_block_t random = BenchRandom(world, (uint32_t)n);
+        Vector2 center = PolarOffset(world->player.center, (float)(random.word[0] % stormRadius), random.word[1]);
+        float radius = random.word[2] % (asteroidMaxSize - asteroidMinSize + 1) + asteroidMinSize;
+        if (SpawnAsteroid(world, center, radius, random.word[3]) == -1)
+            break;
+    }
+    *input = inputRight | ((tick / 60) % 2 == 0 ? inputThrust : inputBrake);
+}
+
+static const scenario_t scenarios[] = {
+    {"fire-1k", 3000, 1000, 300, 0, 0, FireTick},
+    {"fire-10k", 1000, 10000, 300, 0, 0, FireTick},
+    {"fire-100k", 100, 100000, 300, 0, 0, FireTick},
+    {"split-cascade", 3000, 2000, 300, 0, 0, CascadeTick},
+    {"idle-field", 3000, 0, 0, 16, 200000, IdleTick},
+    {"player-storm", 3000, 5000, 0, 0, 0, StormTick},
+};
+static const int scenarioCount = sizeof(scenarios) / sizeof(scenarios[0]);
+
+static bench_result_t RunScenario(const scenario_t *scenario, long ticks, int threads)
+{
+    bench_result_t result = {0};
+    world_config_t config = DefaultWorldConfig();
+    config.maxBullets = scenario->bullets > config.maxBullets ? scenario->bullets : config.maxBullets;
+    if (scenario->asteroids * 2 > config.maxAsteroids)
+        config.maxAsteroids = scenario->asteroids * 2; // room for splits
+    if (scenario->chunks > 0)
+        config = ChunkedWorldConfig(config, scenario->chunks, scenario->fieldAsteroids);
+    world_t *world = CreateWorld(config);
+    profiler_t profiler = {0};
+    if (world == NULL || !InitProfiler(&profiler, false))
+    {
+        DestroyWorld(world);
+        return result;
+    }
+    job_system_t jobs;
+    bool useJobs = threads != 1;
+    if (useJobs && !InitJobSystem(&jobs, threads > 1 ? threads - 1 : 0))
+    {
+        FreeProfiler(&profiler);
+        DestroyWorld(world);
+        return result;
+    }
+    if (useJobs)
+        world->jobs = &jobs;
+    world->profiler = &profiler;
+    world->player.hp = immortal;
+
+    int64_t phaseTotal[3] = {0};
+    double entityTicks = 0;
+    long warmup = ticks / 5;
+    double start = 0;
+    for (long tick = 0; tick < warmup + ticks; tick++)
+    {
+        if (tick == warmup)
+            start = Now();
+        unsigned int input;
+        ProfileBeginFrame(&profiler);
+        ProfileBegin(&profiler, phaseSpawn);
+        scenario->tick(world, scenario, tick, &input);
+        ProfileEnd(&profiler, phaseSpawn);
+        StepWorld(world, input);
+        if (tick >= warmup)
+        {
+            for (int p = 0; p < 3; p++)
+                phaseTotal[p] += profiler.current[benchPhases[p]];
+            entityTicks += world->bullet.pool.count + world->asteroid.pool.count;
+        }
+        ProfileEndFrame(&profiler);
+    }
+    double elapsed = Now() - start;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    result = (bench_result_t){.ok = world->state == gameStatePlaying, .ticks = ticks,
+                              .ticksPerSecond = elapsed > 0 ? ticks / elapsed : 0,
+                              .entities = entityTicks / ticks, .peakMemoryKb = usage.ru_maxrss};
+    for (int p = 0; p < 3; p++)
+        result.nsPerEntity[p] = entityTicks > 0 ? phaseTotal[p] / entityTicks : 0;
+
+    if (useJobs)
+        ShutdownJobSystem(&jobs);
+    FreeProfiler(&profiler);
+    DestroyWorld(world);
+    return result;
+}
+
+// in a child, so the peak memory of one scenario never carries into the next
+static bench_result_t RunIsolated(const scenario_t *scenario, long ticks, int threads)
+{
+    bench_result_t result = {0};
+    int fds[2];
+    if (pipe(fds) != 0)
+        return result;
+    fflush(NULL);
+    pid_t child = fork();
+    if (child == 0)
+    {
+        close(fds[0]);
+        result = RunScenario(scenario, ticks, threads);
+        _exit(write(fds[1], &result, sizeof(result)) == sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+    if (child < 0 || read(fds[0], &result, sizeof(result)) != sizeof(result))
+        result = (bench_result_t){0};
+    close(fds[0]);
+    if (child > 0)
+        waitpid(child, NULL, 0);
+    return result;
+}
+
+// one scenario per line, which is all ReadBaseline relies on
+static void WriteReport(FILE *file, const bench_result_t *results, int threads)
+{
+    fprintf(file, "{\n  \"instructionSet\": \"%s\",\n  \"threads\": %i,\n  \"scenarios\": [\n",
+            KernelsInstructionSet(), threads);
+    bool first = true;
+    for (int i = 0; i < scenarioCount; i++)
+    {
+        const bench_result_t *r = &results[i];
+        if (r->ticks == 0)
+            continue;
+        fprintf(file,
+                "%s    {\"name\": \"%s\", \"ok\": %s, \"ticks\": %ld, \"ticksPerSecond\": %.1f, \"entities\": %.0f, "
+                "\"nsPerEntity\": {\"spawn\": %.3f, \"integration\": %.3f, \"collision\": %.3f}, "
+                "\"peakMemoryKb\": %ld}",
+                first ? "" : ",\n", scenarios[i].name, r->ok ? "true" : "false", r->ticks, r->ticksPerSecond,
+                r->entities, r->nsPerEntity[0], r->nsPerEntity[1], r->nsPerEntity[2], r->peakMemoryKb);
+        first = false;
+    }
+    fprintf(file, "\n  ]\n}\n");
+}
+
+// finds name's line in a report written by WriteReport
+static bool ReadBaseline(FILE *file, const char *name, double *ticksPerSecond, long *peakMemoryKb)
+{
+    char line[1024];
+    char key[128];
+    snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+    rewind(file);
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (strstr(line, key) == NULL)
+            continue;
+        const char *tps = strstr(line, "\"ticksPerSecond\": ");
+        const char *memory = strstr(line, "\"peakMemoryKb\": ");
+        return tps != NULL && memory != NULL && sscanf(tps, "\"ticksPerSecond\": %lf", ticksPerSecond) == 1 &&
+               sscanf(memory, "\"peakMemoryKb\": %ld", peakMemoryKb) == 1;
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    long ticks = 0;
+    int threads = 1;
+    int repeats = defaultRepeats;
+    const char *only = NULL;
+    const char *jsonPath = NULL;
+    const char *baselinePath = NULL;
+    float threshold = defaultThreshold;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--ticks") == 0)
+            ticks = atol(argv[i + 1]);
+        else if (strcmp(argv[i], "--threads") == 0)
+            threads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--repeats") == 0)
+            repeats = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--only") == 0)
+            only = argv[i + 1];
+        else if (strcmp(argv[i], "--json") == 0)
+            jsonPath = argv[i + 1];
+        else if (strcmp(argv[i], "--baseline") == 0)
+            baselinePath = argv[i + 1];
+        else if (strcmp(argv[i], "--threshold") == 0)
+            threshold = (float)atof(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (argc % 2 == 0)
+    {
+        fprintf(stderr, "%s needs a value\n", argv[argc - 1]);
+        return 1;
+    }
+    if (!(threshold > 0))
+    {
+        fprintf(stderr, "--threshold must be above 0\n");
+        return 1;
+    }
+
+    FILE *baseline = NULL;
+    if (baselinePath != NULL && (baseline = fopen(baselinePath, "r")) == NULL)
+    {
+        fprintf(stderr, "failed to read %s\n", baselinePath);
+        return 1;
+    }
+
+    bench_result_t results[sizeof(scenarios) / sizeof(scenarios[0])] = {0};
+    bool failed = false;
+    bool regressed = false;
+    for (int i = 0; i < scenarioCount; i++)
+    {
+        const scenario_t *scenario = &scenarios[i];
+        if (only != NULL && strstr(scenario->name, only) == NULL)
+            continue;
+        bench_result_t *r = &results[i];
+        for (int run = 0; run < (repeats > 0 ? repeats : 1); run++)
+        {
+            bench_result_t attempt = RunIsolated(scenario, ticks > 0 ? ticks : scenario->ticks, threads);
+            if (attempt.ticks == 0 || !attempt.ok)
+            {
+                *r = attempt;
+                break;
+            }
+            // noise only ever slows a run down, while memory has to fit the worst of them
+            long peakMemoryKb = attempt.peakMemoryKb > r->peakMemoryKb ? attempt.peakMemoryKb : r->peakMemoryKb;
+            if (attempt.ticksPerSecond > r->ticksPerSecond)
+                *r = attempt;
+            r->peakMemoryKb = peakMemoryKb;
+        }
+        if (r->ticks == 0 || !r->ok)
+        {
+            fprintf(stderr, "%-14s failed to run\n", scenario->name);
+            failed = true;
+            continue;
+        }
+        fprintf(stderr, "%-14s %10.1f ticks/s %9.0f entities %8ld kb", scenario->name, r->ticksPerSecond, r->entities,
+                r->peakMemoryKb);
+        double baseTicksPerSecond;
+        long basePeakMemoryKb;
+        bool inBaseline =
+            baseline != NULL && ReadBaseline(baseline, scenario->name, &baseTicksPerSecond, &basePeakMemoryKb);
+        if (inBaseline && (!(baseTicksPerSecond > 0) || basePeakMemoryKb <= 0))
+        {
+            // a hand edited baseline, nothing compares against 0 or nan
+            fprintf(stderr, "  baseline is not above 0");
+            failed = true;
+        }
+        else if (inBaseline)
+        {
+            double speed = (r->ticksPerSecond / baseTicksPerSecond - 1) * 100;
+            double memory = ((double)r->peakMemoryKb / basePeakMemoryKb - 1) * 100;
+            bool worse = speed < -threshold || memory > threshold;
+            fprintf(stderr, "  %+6.1f%% speed %+6.1f%% memory%s", speed, memory, worse ? "  REGRESSED" : "");
+            regressed |= worse;
+        }
+        else if (baseline != NULL)
+        {
+            fprintf(stderr, "  not in baseline");
+        }
+        fprintf(stderr, "\n");
+    }
+    if (baseline != NULL)
+        fclose(baseline);
+
+    FILE *json = jsonPath != NULL ? fopen(jsonPath, "w") : stdout;
+    if (json == NULL)
+    {
+        fprintf(stderr, "failed to write %s\n", jsonPath);
+        return 1;
+    }
+    WriteReport(json, results, threads);
+    if (json != stdout)
+        fclose(json);
+    if (failed)
+        return 1;
+    return regressed ? 2 : 0;
+}
@@ -0,0 +1,139 @@
+#include "bitpack.h"
+
+static const int varUnsignedWidth[4] = {4, 8, 12, 32};
+static const int smallSignedWidth[4] = {0, 6, 10, 16};
+
+bit_writer_t BitWriter(uint8_t *data, size_t capacity)
+{
+    return (bit_writer_t){.data = data, .capacity = capacity};
+}
+
+static void PutBits(uint8_t *data, size_t position, uint32_t value, int count)
+{
+    while (count > 0)
+    {
+        int offset = position & 7;
+        int take = 8 - offset < count ? 8 - offset : count;
+        uint32_t mask = (1u << take) - 1;
+        data[position >> 3] = (data[position >> 3] & ~(mask << offset)) | (value & mask) << offset;
+        value >>= take;
+        position += take;
+        count -= take;
+    }
+}
+
+void WriteBits(bit_writer_t *writer, uint32_t value, int count)
+{
+    if (writer->overflow || writer->bit + count > writer->capacity * 8)
+    {
+        writer->overflow = true;
+        return;
+    }
+    PutBits(writer->data, writer->bit, value, count);
+    writer->bit += count;
+}
+
+void PatchBits(bit_writer_t *writer, size_t position, uint32_t value, int count)
+{
+    if (position + count <= writer->bit)
+        PutBits(writer->data, position, value, count);
+}
+
+size_t BitWriterBytes(const bit_writer_t *writer)
+{
+    return (writer->bit + 7) / 8;
+}
+
+size_t BitsLeft(const bit_writer_t *writer)
+{
+    return writer->overflow ? 0 : writer->capacity * 8 - writer->bit;
+}
+
+bit_reader_t BitReader(const uint8_t *data, size_t size)
+{
+    return (bit_reader_t){.data = data, .size = size};
+}
+
+uint32_t ReadBits(bit_reader_t *reader, int count)
+{
+    if (reader->overflow || reader->bit + count > reader->size * 8)
+    {
+        reader->overflow = true;
+        return 0;
+    }
+    uint32_t value = 0;
+    int done = 0;
+    while (done < count)
+    {
+        int offset = reader->bit & 7;
+        int take = 8 - offset < count - done ? 8 - offset : count - done;
+        uint32_t bits = (reader->data[reader->bit >> 3] >> offset) & ((1u << take) - 1);
+        value |= bits << done;
+        done += take;
+        reader->bit += take;
+    }
+    return value;
+}
+
+static int VarUnsignedClass(uint32_t value)
+{
+    if (value < 1u << 4)
+        return 0;
+    if (value < 1u << 8)
+        return 1;
+    if (value < 1u << 12)
+        return 2;
+    return 3;
+}
+
+void WriteVarUnsigned(bit_writer_t *writer, uint32_t value)
+{
+    int class = VarUnsignedClass(value);
+    WriteBits(writer, class, 2);
+    WriteBits(writer, value, varUnsignedWidth[class]);
+}
+
+uint32_t ReadVarUnsigned(bit_reader_t *reader)
+{
+    return ReadBits(reader, varUnsignedWidth[ReadBits(reader, 2)]);
+}
+
+int VarUnsignedBits(uint32_t value)
+{
+    return 2 + varUnsignedWidth[VarUnsignedClass(value)];
+}
+
+static uint32_t ZigZag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int SmallSignedClass(uint32_t zigzag)
+{
+    if (zigzag == 0)
+        return 0;
+    if (zigzag < 1u << 6)
+        return 1;
+    if (zigzag < 1u << 10)
+        return 2;
+    return 3;
+}
+
+void WriteSmallSigned(bit_writer_t *writer, int32_t value)
+{
+    uint32_t zigzag = ZigZag(value);
+    int class = SmallSignedClass(zigzag);
+    WriteBits(writer, class, 2);
+    WriteBits(writer, zigzag, smallSignedWidth[class]);
+}
+
+int32_t ReadSmallSigned(bit_reader_t *reader)
+{
+    uint32_t zigzag = ReadBits(reader, smallSignedWidth[ReadBits(reader, 2)]);
+    return (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+}
+
+int SmallSignedBits(int32_t value)
+{
+    return 2 + smallSignedWidth[SmallSignedClass(ZigZag(value))];
+}
@@ -0,0 +1,45 @@
+#ifndef BITPACK_H
+#define BITPACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// least significant bit first packing for network packets. running past the end sets overflow
+// instead of writing or reading out of bounds, so callers can check once at the end
+typedef struct bit_writer_t
+{
+    uint8_t *data;
+    size_t capacity; // bytes
+    size_t bit;      // bits written
+    bool overflow;
+} bit_writer_t;
+
+typedef struct bit_reader_t
+{
+    const uint8_t *data;
+    size_t size; // bytes
+    size_t bit;
+    bool overflow;
+} bit_reader_t;
+
+bit_writer_t BitWriter(uint8_t *data, size_t capacity);
+void WriteBits(bit_writer_t *writer, uint32_t value, int count); // count up to 32
+// overwrites bits already written at position, for counts only known at the end
+void PatchBits(bit_writer_t *writer, size_t position, uint32_t value, int count);
+size_t BitWriterBytes(const bit_writer_t *writer);
+size_t BitsLeft(const bit_writer_t *writer);
+
+bit_reader_t BitReader(const uint8_t *data, size_t size);
+uint32_t ReadBits(bit_reader_t *reader, int count);
+
+// 2 bit length class then 4, 8, 12 or 32 bits
+void WriteVarUnsigned(bit_writer_t *writer, uint32_t value);
+uint32_t ReadVarUnsigned(bit_reader_t *reader);
+int VarUnsignedBits(uint32_t value);
+// 2 bit length class then nothing for zero, or a zigzag value in 6, 10 or 16 bits. value must fit in 16 signed bits
+void WriteSmallSigned(bit_writer_t *writer, int32_t value);
+int32_t ReadSmallSigned(bit_reader_t *reader);
+int SmallSignedBits(int32_t value);
+
+#endif
@@ -1,2 +1,12 @@
 #!/bin/sh
-cc main.c `pkg-config --libs --cflags raylib` -o game
\ No newline at end of file
+cc -ffp-contract=off main.c render.c particles.c capture.c latency.c net.c bitpack.c game.c replay.c entity.c kernels.c jobs.c pool.c arena.c snapshot.c profiler.c trig.c rng.c spatial_hash.c polygon.c chunks.c `pkg-config --libs --cflags raylib` -lm -lpthread -o game
+# -ffp-contract=off keeps a * b + c as two rounded ops, fused multiply adds would change replay hashes
+# the simulation only needs raylib's header, so headless runs on machines without a display
+cc -O2 -march=native -ffp-contract=off headless.c env.c game.c replay.c entity.c kernels.c jobs.c pool.c arena.c snapshot.c profiler.c trig.c rng.c spatial_hash.c polygon.c chunks.c `pkg-config --cflags raylib` -lm -lpthread -o headless
+# batch env api as a shared library for training code to load through its ffi
+cc -O2 -march=native -ffp-contract=off -shared -fPIC env.c game.c replay.c entity.c kernels.c jobs.c pool.c arena.c snapshot.c profiler.c trig.c rng.c spatial_hash.c polygon.c chunks.c `pkg-config --cflags raylib` -lm -lpthread -o libasteroids_env.so
+# server and load generator, linux only (epoll, recvmmsg)
+cc -O2 -march=native -ffp-contract=off server.c net.c bitpack.c game.c replay.c entity.c kernels.c jobs.c pool.c arena.c snapshot.c profiler.c trig.c rng.c spatial_hash.c polygon.c chunks.c `pkg-config --cflags raylib` -lm -lpthread -o server
+cc -O2 -march=native -ffp-contract=off loadgen.c net.c bitpack.c game.c replay.c entity.c kernels.c jobs.c pool.c arena.c snapshot.c profiler.c trig.c rng.c spatial_hash.c polygon.c chunks.c `pkg-config --cflags raylib` -lm -lpthread -o loadgen
+# scenario benchmark, ./bench --baseline bench_baseline.json exits 2 on a regression
+cc -O2 -march=native -ffp-contract=off bench.c game.c replay.c entity.c kernels.c jobs.c pool.c arena.c snapshot.c profiler.c trig.c rng.c spatial_hash.c polygon.c chunks.c `pkg-config --cflags raylib` -lm -lpthread -o bench
@@ -0,0 +1,229 @@
+#include "capture.h"
+#include "rlgl.h"
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned char Chroma(int value)
+{
+    value += 128;
+    return (unsigned char)(value < 0 ? 0 : value > 255 ? 255 : value);
+}
+
+// rgba bottom up to full range bt.601 y, cb, cr with 2 x 2 averaged chroma, the layout C420jpeg expects
+static void ConvertToYuv(const unsigned char *rgba, unsigned char *yuv, int width, int height)
+{
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    unsigned char *lumaPlane = yuv;
+    unsigned char *cbPlane = yuv + width * height;
+    unsigned char *crPlane = cbPlane + chromaWidth * chromaHeight;
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char *row = rgba + (size_t)(height - 1 - y) * width * 4;
+        for (int x = 0; x < width; x++)
+        {
+            const unsigned char *p = row + x * 4;
+            lumaPlane[y * width + x] = (unsigned char)((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+        }
+    }
+    for (int cy = 0; cy < chromaHeight; cy++)
+    {
+        int y0 = cy * 2;
+        int y1 = y0 + 1 < height ? y0 + 1 : y0;
+        const unsigned char *top = rgba + (size_t)(height - 1 - y0) * width * 4;
+        const unsigned char *bottom = rgba + (size_t)(height - 1 - y1) * width * 4;
+        for (int cx = 0; cx < chromaWidth; cx++)
+        {
+            int x0 = cx * 2 * 4;
+            int x1 = cx * 2 + 1 < width ? x0 + 4 : x0;
+            int r = top[x0] + top[x1] + bottom[x0] + bottom[x1];
+            int g = top[x0 + 1] + top[x1 + 1] + bottom[x0 + 1] + bottom[x1 + 1];
+            int b = top[x0 + 2] + top[x1 + 2] + bottom[x0 + 2] + bottom[x1 + 2];
+            // sums of four, so the shift is two more than for one pixel
+            cbPlane[cy * chromaWidth + cx] = Chroma((-43 * r - 85 * g + 128 * b + 512) >> 10);
+            crPlane[cy * chromaWidth + cx] = Chroma((128 * r - 107 * g - 21 * b + 512) >> 10);
+        }
+    }
+}
+
+static size_t YuvBytes(const capture_t *capture)
+{
+    return (size_t)capture->width * capture->height +
+           2 * (size_t)((capture->width + 1) / 2) * ((capture->height + 1) / 2);
+}
+
+static bool WriteYuvFrame(capture_t *capture)
+{
+    if (fputs("FRAME\n", capture->file) == EOF || fwrite(capture->yuv, YuvBytes(capture), 1, capture->file) != 1)
+        return false;
+    capture->written++;
+    return true;
+}
+
+// runs on the writer thread. gaps left by dropped frames are filled with the frame before them in a video,
+// a png sequence just skips their numbers
+static bool WriteFrame(capture_t *capture, capture_frame_t frame)
+{
+    if (capture->format == captureFormatPng)
+    {
+        // flipped in place, the buffer is the writer's now
+        size_t rowBytes = (size_t)capture->width * 4;
+        unsigned char *swap = malloc(rowBytes);
+        if (swap == NULL)
+            return false;
+        for (int y = 0; y < capture->height / 2; y++)
+        {
+            unsigned char *a = frame.pixels + y * rowBytes;
+            unsigned char *b = frame.pixels + (capture->height - 1 - y) * rowBytes;
+            memcpy(swap, a, rowBytes);
+            memcpy(a, b, rowBytes);
+            memcpy(b, swap, rowBytes);
+        }
+        free(swap);
+        Image image = {.data = frame.pixels, .width = capture->width, .height = capture->height, .mipmaps = 1,
+                       .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+        char name[1024];
+        snprintf(name, sizeof(name), "%s%06ld.png", capture->path, frame.index);
+        if (!ExportImage(image, name))
+            return false;
+        capture->written++;
+        return true;
+    }
+
+    while (capture->written > 0 && capture->written < frame.index)
+        if (!WriteYuvFrame(capture))
+            return false;
+    ConvertToYuv(frame.pixels, capture->yuv, capture->width, capture->height);
+    while (capture->written <= frame.index) // a gap at the very start has nothing before it
+        if (!WriteYuvFrame(capture))
+            return false;
+    return true;
+}
+
+static void *WriterMain(void *argument)
+{
+    capture_t *capture = argument;
+    for (;;)
+    {
+        sem_wait(&capture->ready);
+        long tail = atomic_load_explicit(&capture->tail, memory_order_relaxed);
+        if (tail == atomic_load_explicit(&capture->head, memory_order_acquire))
+        {
+            if (atomic_load(&capture->stopping))
+                break;
+            continue;
+        }
+        capture_frame_t frame = capture->queue[tail % CAPTURE_QUEUE];
+        if (!atomic_load_explicit(&capture->writeFailed, memory_order_relaxed) && !WriteFrame(capture, frame))
+            atomic_store(&capture->writeFailed, true);
+        MemFree(frame.pixels);
+        atomic_store_explicit(&capture->tail, tail + 1, memory_order_release);
+        sem_post(&capture->drained);
+    }
+    return NULL;
+}
+
+static void ReleaseCapture(capture_t *capture)
+{
+    sem_destroy(&capture->ready);
+    sem_destroy(&capture->drained);
+    for (int i = 0; i < CAPTURE_TARGETS; i++)
+        UnloadRenderTexture(capture->target[i]);
+    if (capture->file != NULL)
+        fclose(capture->file);
+    capture->file = NULL;
+    free(capture->yuv);
+    capture->yuv = NULL;
+}
+
+bool StartCapture(capture_t *capture, const char *path, int width, int height, int fps, bool waitWhenFull)
+{
+    size_t length = strlen(path);
+    bool video = length >= 4 && strcmp(path + length - 4, ".y4m") == 0;
+    *capture = (capture_t){.format = video ? captureFormatY4m : captureFormatPng, .path = path, .width = width,
+                           .height = height, .fps = fps, .waitWhenFull = waitWhenFull};
+    if (video)
+    {
+        capture->file = fopen(path, "wb");
+        capture->yuv = malloc(YuvBytes(capture));
+        if (capture->file == NULL || capture->yuv == NULL ||
+            fprintf(capture->file, "YUV4MPEG2 W%i H%i F%i:1 Ip A1:1 C420jpeg\n", width, height, fps) < 0)
+        {
+            if (capture->file != NULL)
+                fclose(capture->file);
+            free(capture->yuv);
+            return false;
+        }
+    }
+    for (int i = 0; i < CAPTURE_TARGETS; i++)
+        capture->target[i] = LoadRenderTexture(width, height);
+    sem_init(&capture->ready, 0, 0);
+    sem_init(&capture->drained, 0, 0);
+    if (pthread_create(&capture->writer, NULL, WriterMain, capture) != 0)
+    {
+        ReleaseCapture(capture);
+        return false;
+    }
+    return true;
+}
+
+// never waits unless asked to, a full queue costs the frame instead of the frame time
+static void QueueFrame(capture_t *capture, long index)
+{
+    if (atomic_load_explicit(&capture->writeFailed, memory_order_relaxed))
+    {
+        atomic_fetch_add_explicit(&capture->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    long head = atomic_load_explicit(&capture->head, memory_order_relaxed);
+    while (head - atomic_load_explicit(&capture->tail, memory_order_acquire) >= CAPTURE_QUEUE)
+    {
+        if (!capture->waitWhenFull)
+        {
+            atomic_fetch_add_explicit(&capture->dropped, 1, memory_order_relaxed);
+            return;
+        }
+        sem_wait(&capture->drained);
+    }
+    Texture2D texture = capture->target[index % CAPTURE_TARGETS].texture;
+    unsigned char *pixels = rlReadTexturePixels(texture.id, texture.width, texture.height, texture.format);
+    if (pixels == NULL)
+    {
+        atomic_fetch_add_explicit(&capture->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    capture->queue[head % CAPTURE_QUEUE] = (capture_frame_t){.pixels = pixels, .index = index};
+    atomic_store_explicit(&capture->head, head + 1, memory_order_release);
+    sem_post(&capture->ready);
+}
+
+void StopCapture(capture_t *capture)
+{
+    // the last frames are still in their targets, they go out whatever the queue looks like
+    capture->waitWhenFull = true;
+    long first = capture->frame - CAPTURE_TARGETS + 1;
+    for (long index = first > 0 ? first : 0; index < capture->frame; index++)
+        QueueFrame(capture, index);
+    atomic_store(&capture->stopping, true);
+    sem_post(&capture->ready);
+    pthread_join(capture->writer, NULL);
+    ReleaseCapture(capture);
+}
+
+void BeginCaptureFrame(capture_t *capture)
+{
+    BeginTextureMode(capture->target[capture->frame % CAPTURE_TARGETS]);
+}
+
+void EndCaptureFrame(capture_t *capture)
+{
+    EndTextureMode();
+    // render textures come out upside down, a negative source height flips them back
+    Texture2D texture = capture->target[capture->frame % CAPTURE_TARGETS].texture;
+    DrawTextureRec(texture, (Rectangle){0, 0, (float)texture.width, (float)-texture.height}, (Vector2){0, 0}, WHITE);
+    capture->frame++;
+    // the target drawn CAPTURE_TARGETS - 1 frames ago, the gpu finished it while the later ones were drawn
+    long finished = capture->frame - CAPTURE_TARGETS;
+    if (finished >= 0)
+        QueueFrame(capture, finished);
+}
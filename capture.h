@@ -0,0 +1,66 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "raylib.h"
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define CAPTURE_TARGETS 3 // frames are read back this many minus one frames after they were drawn
+#define CAPTURE_QUEUE 8   // read back frames waiting for the writer, past that they are dropped
+
+typedef enum capture_format_e
+{
+    captureFormatY4m, // one raw 4:2:0 video file
+    captureFormatPng  // one numbered png per frame
+} capture_format_e;
+
+typedef struct capture_frame_t
+{
+    unsigned char *pixels; // rgba, bottom row first the way gl reads it. the writer frees it
+    long index;            // frames since StartCapture
+} capture_frame_t;
+
+// records what the game draws without waiting on the gpu or the disk. each frame is drawn into one of
+// CAPTURE_TARGETS render textures and read back only once the gpu is long done with it, then handed to a
+// writer thread through a single producer single consumer ring
+typedef struct capture_t
+{
+    capture_format_e format;
+    const char *path; // the .y4m file, or the prefix every png name starts with
+    int width;
+    int height;
+    int fps;
+    bool waitWhenFull; // wait for the writer instead of dropping, for offline renders that have no frame deadline
+
+    RenderTexture2D target[CAPTURE_TARGETS];
+    long frame; // drawn into the targets so far
+
+    capture_frame_t queue[CAPTURE_QUEUE];
+    _Atomic long head; // pushed by the render thread
+    _Atomic long tail; // popped by the writer
+    sem_t ready;       // posted once per pushed frame and once to stop
+    sem_t drained;     // posted once per popped frame
+    atomic_bool stopping;
+    pthread_t writer;
+
+    FILE *file;              // y4m only
+    unsigned char *yuv;      // y4m only, the last frame written, repeated over dropped ones so the video keeps time
+    long written;            // frames the writer finished, repeats included
+    _Atomic long dropped;    // frames that found the queue full
+    atomic_bool writeFailed; // the writer could not write, everything after is dropped
+} capture_t;
+
+// a path ending in .y4m writes video, anything else is the prefix of a png sequence. needs a window
+bool StartCapture(capture_t *capture, const char *path, int width, int height, int fps, bool waitWhenFull);
+// writes out the frames still in flight, then stops the writer
+void StopCapture(capture_t *capture);
+
+// in place of BeginDrawing's default framebuffer, everything until EndCaptureFrame lands in the capture
+void BeginCaptureFrame(capture_t *capture);
+// shows the frame on screen and queues the oldest finished one. call before EndDrawing
+void EndCaptureFrame(capture_t *capture);
+
+#endif
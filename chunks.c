@@ -0,0 +1,199 @@
+#include "chunks.h"
+#include <math.h>
+
+const float chunkSize = 1280;
+
+void PlaceChunkField(chunk_field_t *field, int columns, int rows, int capacity, arena_t *arena)
+{
+    field->columns = columns;
+    field->rows = rows;
+    field->width = columns * chunkSize;
+    field->height = rows * chunkSize;
+    field->capacity = capacity;
+    field->parked = ArenaTake(arena, capacity * sizeof(parked_asteroid_t));
+    field->chunkHead = ArenaTake(arena, columns * rows * sizeof(int));
+    field->wheelHead = ArenaTake(arena, (columns > 0 ? CHUNK_WHEEL_SIZE : 0) * sizeof(int));
+}
+
+void ClearChunkField(chunk_field_t *field)
+{
+    if (field->columns == 0)
+        return;
+    field->count = 0;
+    for (int i = 0; i < field->columns * field->rows; i++)
+        field->chunkHead[i] = -1;
+    for (int i = 0; i < CHUNK_WHEEL_SIZE; i++)
+        field->wheelHead[i] = -1;
+    field->freeHead = field->capacity > 0 ? 0 : -1;
+    for (int i = 0; i < field->capacity; i++)
+        field->parked[i].nextInChunk = i + 1 < field->capacity ? i + 1 : -1;
+}
+
+int ChunkAt(const chunk_field_t *field, float x, float y)
+{
+    int column = (int)floorf(x / chunkSize);
+    int row = (int)floorf(y / chunkSize);
+    column = column < 0 ? 0 : (column >= field->columns ? field->columns - 1 : column);
+    row = row < 0 ? 0 : (row >= field->rows ? field->rows - 1 : row);
+    return row * field->columns + column;
+}
+
+// reflects p into 0..length the way bouncing off both ends would, direction is -1 after an odd number of bounces
+static float Fold(float p, float length, float *direction)
+{
+    if (p >= 0 && p <= length) // nearly every call, no bounce since the anchor
+    {
+        *direction = 1;
+        return p;
+    }
+    float period = 2 * length;
+    float u = fmodf(p, period);
+    if (u < 0)
+        u += period;
+    if (u <= length)
+    {
+        *direction = 1;
+        return u;
+    }
+    *direction = -1;
+    return period - u;
+}
+
+static void MoveTo(const chunk_field_t *field, parked_asteroid_t *a, int32_t tick)
+{
+    float elapsed = (float)(tick - a->anchorTick);
+    float dx, dy;
+    a->x = Fold(a->x + a->vx * elapsed, field->width, &dx);
+    a->y = Fold(a->y + a->vy * elapsed, field->height, &dy);
+    a->vx *= dx;
+    a->vy *= dy;
+    a->anchorTick = tick;
+}
+
+// ticks until p leaves low..high moving at v, bouncing first if that side is the field's edge
+static float TimeToLeave(float p, float v, float low, float high, float length)
+{
+    if (v > 0)
+        return high >= length ? (length - p + length - low) / v : (high - p) / v;
+    if (v < 0)
+        return low <= 0 ? (p + high) / -v : (p - low) / -v;
+    return INFINITY;
+}
+
+static int32_t WakeTick(const chunk_field_t *field, const parked_asteroid_t *a)
+{
+    float low = (a->chunk % field->columns) * chunkSize;
+    float top = (a->chunk / field->columns) * chunkSize;
+    float t = fminf(TimeToLeave(a->x, a->vx, low, low + chunkSize, field->width),
+                    TimeToLeave(a->y, a->vy, top, top + chunkSize, field->height));
+    if (!(t < INT32_MAX / 2))
+        return -1;
+    return a->anchorTick + (int32_t)t + 1; // the first tick it is outside
+}
+
+static void LinkChunk(chunk_field_t *field, int index)
+{
+    parked_asteroid_t *a = &field->parked[index];
+    a->previousInChunk = -1;
+    a->nextInChunk = field->chunkHead[a->chunk];
+    if (a->nextInChunk != -1)
+        field->parked[a->nextInChunk].previousInChunk = index;
+    field->chunkHead[a->chunk] = index;
+}
+
+static void UnlinkChunk(chunk_field_t *field, int index)
+{
+    parked_asteroid_t *a = &field->parked[index];
+    if (a->previousInChunk != -1)
+        field->parked[a->previousInChunk].nextInChunk = a->nextInChunk;
+    else
+        field->chunkHead[a->chunk] = a->nextInChunk;
+    if (a->nextInChunk != -1)
+        field->parked[a->nextInChunk].previousInChunk = a->previousInChunk;
+}
+
+static void LinkWheel(chunk_field_t *field, int index)
+{
+    parked_asteroid_t *a = &field->parked[index];
+    if (a->wakeTick == -1)
+        return;
+    int *head = &field->wheelHead[a->wakeTick & (CHUNK_WHEEL_SIZE - 1)];
+    a->previousInWheel = -1;
+    a->nextInWheel = *head;
+    if (*head != -1)
+        field->parked[*head].previousInWheel = index;
+    *head = index;
+}
+
+static void UnlinkWheel(chunk_field_t *field, int index)
+{
+    parked_asteroid_t *a = &field->parked[index];
+    if (a->wakeTick == -1)
+        return;
+    if (a->previousInWheel != -1)
+        field->parked[a->previousInWheel].nextInWheel = a->nextInWheel;
+    else
+        field->wheelHead[a->wakeTick & (CHUNK_WHEEL_SIZE - 1)] = a->nextInWheel;
+    if (a->nextInWheel != -1)
+        field->parked[a->nextInWheel].previousInWheel = a->previousInWheel;
+}
+
+bool ParkAsteroid(chunk_field_t *field, parked_asteroid_t asteroid, int32_t tick)
+{
+    if (field->freeHead == -1)
+        return false;
+    int index = field->freeHead;
+    field->freeHead = field->parked[index].nextInChunk;
+    field->count++;
+
+    asteroid.anchorTick = tick;
+    asteroid.chunk = ChunkAt(field, asteroid.x, asteroid.y);
+    field->parked[index] = asteroid;
+    field->parked[index].wakeTick = WakeTick(field, &asteroid);
+    LinkChunk(field, index);
+    LinkWheel(field, index);
+    return true;
+}
+
+void AdvanceChunkField(chunk_field_t *field, int32_t tick)
+{
+    if (field->columns == 0)
+        return;
+    int index = field->wheelHead[tick & (CHUNK_WHEEL_SIZE - 1)];
+    while (index != -1)
+    {
+        parked_asteroid_t *a = &field->parked[index];
+        int next = a->nextInWheel; // relinking may push a onto this same slot, it is not visited again
+        if (a->wakeTick == tick)
+        {
+            UnlinkWheel(field, index);
+            UnlinkChunk(field, index);
+            MoveTo(field, a, tick);
+            a->chunk = ChunkAt(field, a->x, a->y);
+            a->wakeTick = WakeTick(field, a);
+            if (a->wakeTick != -1 && a->wakeTick <= tick)
+                a->wakeTick = tick + 1; // rounding left it on the line, look again next tick
+            LinkChunk(field, index);
+            LinkWheel(field, index);
+        }
+        index = next;
+    }
+}
+
+int UnparkChunk(chunk_field_t *field, int chunk, int32_t tick, parked_asteroid_t *out, int max)
+{
+    int count = 0;
+    while (count < max && field->chunkHead[chunk] != -1)
+    {
+        int index = field->chunkHead[chunk];
+        UnlinkWheel(field, index);
+        UnlinkChunk(field, index);
+        parked_asteroid_t a = field->parked[index];
+        MoveTo(field, &a, tick);
+        out[count++] = a;
+        field->parked[index].nextInChunk = field->freeHead;
+        field->freeHead = index;
+        field->count--;
+    }
+    return count;
+}
@@ -0,0 +1,64 @@
+#ifndef CHUNKS_H
+#define CHUNKS_H
+
+#include "arena.h"
+#include "trig.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CHUNK_WHEEL_SIZE 4096 // ticks the timer wheel spans, power of two. later wake ups go round again
+
+extern const float chunkSize; // square, wider than half the screen plus the largest asteroid
+
+// an asteroid parked in a chunk nobody is near. it is never stepped: asteroids fly straight and bounce off the
+// field's edges, so its state at any later tick follows from where it was at anchorTick
+typedef struct parked_asteroid_t
+{
+    float x; // at anchorTick
+    float y;
+    float vx;
+    float vy;
+    float radius;
+    float speed;
+    float hp;
+    angle_t angle;
+    uint32_t shapeSeed;
+    int32_t anchorTick;
+    int32_t wakeTick; // when it crosses into another chunk, -1 if it never does
+    int chunk;
+    int nextInChunk; // also chains free records
+    int previousInChunk;
+    int nextInWheel;
+    int previousInWheel;
+} parked_asteroid_t;
+
+// the field split into columns x rows chunks, each with a list of the asteroids parked in it. a timer wheel moves
+// every record into its next chunk on the tick it crosses over, so each list is always exactly what is inside that
+// chunk and the cost is one move per crossing instead of one step per tick. lives in the world block
+typedef struct chunk_field_t
+{
+    int columns; // 0 when the world has no chunks
+    int rows;
+    float width; // columns * chunkSize
+    float height;
+    int capacity;
+    int count;
+    parked_asteroid_t *parked;
+    int *chunkHead; // columns * rows, -1 when empty
+    int *wheelHead; // CHUNK_WHEEL_SIZE
+    int freeHead;
+} chunk_field_t;
+
+// points the arrays into the arena, see PlacePool. ClearChunkField before first use
+void PlaceChunkField(chunk_field_t *field, int columns, int rows, int capacity, arena_t *arena);
+void ClearChunkField(chunk_field_t *field);
+
+int ChunkAt(const chunk_field_t *field, float x, float y); // positions outside the field clamp to its border
+// parks an asteroid whose x, y, vx and vy are its state at tick, false when the field is full
+bool ParkAsteroid(chunk_field_t *field, parked_asteroid_t asteroid, int32_t tick);
+// moves every record that crosses into another chunk at tick
+void AdvanceChunkField(chunk_field_t *field, int32_t tick);
+// removes up to max records from chunk and writes them out with x, y, vx and vy as of tick
+int UnparkChunk(chunk_field_t *field, int chunk, int32_t tick, parked_asteroid_t *out, int max);
+
+#endif
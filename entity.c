@@ -0,0 +1,94 @@
+#include "entity.h"
+
+void PlaceEntityArray(entity_array_t *entities, int capacity, arena_t *arena)
+{
+    int requested = capacity;
+    capacity = (capacity + ENTITY_LANES - 1) / ENTITY_LANES * ENTITY_LANES;
+    entities->capacity = capacity;
+    entities->x = ArenaTake(arena, capacity * sizeof(float));
+    entities->y = ArenaTake(arena, capacity * sizeof(float));
+    entities->vx = ArenaTake(arena, capacity * sizeof(float));
+    entities->vy = ArenaTake(arena, capacity * sizeof(float));
+    entities->previousX = ArenaTake(arena, capacity * sizeof(float));
+    entities->previousY = ArenaTake(arena, capacity * sizeof(float));
+    entities->radius = ArenaTake(arena, capacity * sizeof(float));
+    entities->alive = ArenaTake(arena, capacity * sizeof(int32_t));
+    entities->angle = ArenaTake(arena, capacity * sizeof(angle_t));
+    entities->speed = ArenaTake(arena, capacity * sizeof(float));
+    entities->hp = ArenaTake(arena, capacity * sizeof(float));
+    PlacePool(&entities->pool, requested, arena);
+}
+
+static void SetEntityLanes(entity_array_t *entities, int slot, float value)
+{
+    entities->x[slot] = value;
+    entities->y[slot] = value;
+    entities->vx[slot] = value;
+    entities->vy[slot] = value;
+    entities->previousX[slot] = value;
+    entities->previousY[slot] = value;
+    entities->radius[slot] = value;
+    entities->angle[slot] = 0;
+    entities->speed[slot] = value;
+    entities->hp[slot] = value;
+}
+
+static void MoveEntity(entity_array_t *entities, int from, int to)
+{
+    entities->x[to] = entities->x[from];
+    entities->y[to] = entities->y[from];
+    entities->vx[to] = entities->vx[from];
+    entities->vy[to] = entities->vy[from];
+    entities->previousX[to] = entities->previousX[from];
+    entities->previousY[to] = entities->previousY[from];
+    entities->radius[to] = entities->radius[from];
+    entities->alive[to] = entities->alive[from];
+    entities->angle[to] = entities->angle[from];
+    entities->speed[to] = entities->speed[from];
+    entities->hp[to] = entities->hp[from];
+}
+
+void ClearEntities(entity_array_t *entities)
+{
+    for (int i = 0; i < entities->capacity; i++)
+    {
+        SetEntityLanes(entities, i, 0);
+        entities->alive[i] = 0;
+    }
+    ClearPool(&entities->pool);
+}
+
+int SpawnEntity(entity_array_t *entities)
+{
+    int slot = PoolAllocate(&entities->pool);
+    if (slot == -1)
+        return -1;
+    SetEntityLanes(entities, slot, 0);
+    entities->alive[slot] = -1;
+    return slot;
+}
+
+void SweepDeadEntities(entity_array_t *entities)
+{
+    int i = 0;
+    while (i < entities->pool.count)
+    {
+        if (entities->alive[i])
+        {
+            i++;
+            continue;
+        }
+        int moved = PoolRemove(&entities->pool, i);
+        if (moved != -1)
+        {
+            MoveEntity(entities, moved, i);
+            entities->alive[moved] = 0; // keep padding lanes dead for the kernels
+        }
+        // slot i now holds the old last entity, check it before moving on
+    }
+}
+
+int EntityLanes(const entity_array_t *entities)
+{
+    return (entities->pool.count + ENTITY_LANES - 1) / ENTITY_LANES * ENTITY_LANES;
+}
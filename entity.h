@@ -0,0 +1,46 @@
+#ifndef ENTITY_H
+#define ENTITY_H
+
+#include "pool.h"
+#include "trig.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ENTITY_LANES 8 // capacity is padded to this so the kernels never need a scalar tail
+
+// bullets and asteroids stored as structure of arrays.
+// the hot arrays are what every tick walks, the cold ones are only touched on spawn, hit and split.
+// live entities are packed into slots 0..pool.count-1, use pool handles to refer to one across ticks
+typedef struct entity_array_t
+{
+    int capacity; // padded, always a multiple of ENTITY_LANES
+    pool_t pool;
+
+    // hot
+    float *x;
+    float *y;
+    float *vx;
+    float *vy;
+    float *previousX; // position a tick ago, only read when drawing between ticks
+    float *previousY;
+    float *radius;
+    int32_t *alive; // -1 (all bits set) when alive so the kernels can use it as a mask, 0 when dead
+
+    // cold
+    angle_t *angle;
+    float *speed;
+    float *hp;
+} entity_array_t;
+
+// points every lane and the pool into the arena, see PlacePool. the arena's memory must start out zeroed
+void PlaceEntityArray(entity_array_t *entities, int capacity, arena_t *arena);
+void ClearEntities(entity_array_t *entities);
+
+// slot of a new alive entity with every other lane zeroed, or -1 when full
+int SpawnEntity(entity_array_t *entities);
+// frees every slot whose alive lane was cleared and repacks the survivors
+void SweepDeadEntities(entity_array_t *entities);
+// live count rounded up to ENTITY_LANES, what the kernels should be given
+int EntityLanes(const entity_array_t *entities);
+
+#endif
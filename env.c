@@ -0,0 +1,224 @@
+#include "env.h"
+#include <stdlib.h>
+#include <string.h>
+
+const float envDeathPenalty = 50;
+const int envGrain = 4;               // envs per job
+
+batch_env_config_t DefaultBatchEnvConfig(void)
+{
+    return (batch_env_config_t){.world = DefaultWorldConfig(), .minAsteroids = 8, .maxEpisodeTicks = 60 * 60, .threads = 1};
+}
+
+// worlds first so each one starts ARENA_ALIGN aligned, then the counters
+static size_t PlaceBatchEnv(batch_env_t *env, unsigned char *base)
+{
+    arena_t arena = {.base = base};
+    env->worlds = ArenaTake(&arena, env->worldBytes * env->count);
+    env->lastScore = ArenaTake(&arena, env->count * sizeof(int));
+    env->episodeTicks = ArenaTake(&arena, env->count * sizeof(int));
+    env->episodes = ArenaTake(&arena, env->count * sizeof(int));
+    return arena.used;
+}
+
+batch_env_t *CreateBatchEnv(int count, batch_env_config_t config)
+{
+    batch_env_t *env = calloc(1, sizeof(batch_env_t));
+    if (env == NULL || count < 1)
+    {
+        free(env);
+        return NULL;
+    }
+    env->count = count;
+    env->config = config;
+    env->worldBytes = WorldBytes(config.world);
+    void *memory = aligned_alloc(ARENA_ALIGN, PlaceBatchEnv(env, NULL));
+    if (memory == NULL)
+    {
+        free(env);
+        return NULL;
+    }
+    PlaceBatchEnv(env, memory);
+    if (config.threads != 1)
+    {
+        env->jobs = malloc(sizeof(job_system_t));
+        if (env->jobs == NULL || !InitJobSystem(env->jobs, config.threads > 1 ? config.threads - 1 : 0))
+        {
+            free(env->jobs);
+            env->jobs = NULL;
+            DestroyBatchEnv(env);
+            return NULL;
+        }
+    }
+    ResetBatchEnv(env, NULL);
+    return env;
+}
+
+void DestroyBatchEnv(batch_env_t *env)
+{
+    if (env == NULL)
+        return;
+    if (env->jobs != NULL)
+    {
+        ShutdownJobSystem(env->jobs);
+        free(env->jobs);
+    }
+    free(env->worlds);
+    free(env);
+}
+
+world_t *BatchEnvWorld(const batch_env_t *env, int index)
+{
+    return (world_t *)(env->worlds + env->worldBytes * index);
+}
+
+// up to k slots of the entities nearest to from, nearest first. ties keep slot order so results never
+// depend on anything but the state
+static int Nearest(const entity_array_t *entities, Vector2 from, int k, int *slots)
+{
+    float distance[ENV_NEAREST_ASTEROIDS > ENV_NEAREST_BULLETS ? ENV_NEAREST_ASTEROIDS : ENV_NEAREST_BULLETS];
+    int found = 0;
+    for (int i = 0; i < entities->pool.count; i++)
+    {
+        float dx = entities->x[i] - from.x;
+        float dy = entities->y[i] - from.y;
+        float d = dx * dx + dy * dy;
+        if (found == k && d >= distance[k - 1])
+            continue;
+        int at = found < k ? found++ : k - 1;
+        while (at > 0 && distance[at - 1] > d)
+        {
+            distance[at] = distance[at - 1];
+            slots[at] = slots[at - 1];
+            at--;
+        }
+        distance[at] = d;
+        slots[at] = i;
+    }
+    return found;
+}
+
+static void WriteObservation(const world_t *world, float *out)
+{
+    memset(out, 0, ENV_OBSERVATION_SIZE * sizeof(float));
+    const entity_t *player = &world->player;
+    float speedUnit = bulletSpeed * world->tickScale; // a bullet's step per tick at the world's tick rate
+    out[0] = player->center.x / screenWidth;
+    out[1] = player->center.y / screenHeight;
+    out[2] = player->velocity.x / speedUnit;
+    out[3] = player->velocity.y / speedUnit;
+    out[4] = AngleCos(player->angle);
+    out[5] = AngleSin(player->angle);
+    out[6] = player->hp;
+    out[7] = world->playerIsInvincible;
+    out[8] = world->timeSinceLastShot >= world->fireCooldown;
+    out += ENV_PLAYER_FLOATS;
+
+    int slots[ENV_NEAREST_ASTEROIDS];
+    const entity_array_t *asteroid = &world->asteroid;
+    int found = Nearest(asteroid, player->center, ENV_NEAREST_ASTEROIDS, slots);
+    for (int n = 0; n < found; n++)
+    {
+        int i = slots[n];
+        float *o = out + n * ENV_ASTEROID_FLOATS;
+        o[0] = (asteroid->x[i] - player->center.x) / screenWidth;
+        o[1] = (asteroid->y[i] - player->center.y) / screenHeight;
+        o[2] = asteroid->vx[i] / speedUnit;
+        o[3] = asteroid->vy[i] / speedUnit;
+        o[4] = asteroid->radius[i] / asteroidMaxSize;
+    }
+    out += ENV_NEAREST_ASTEROIDS * ENV_ASTEROID_FLOATS;
+
+    const entity_array_t *bullet = &world->bullet;
+    found = Nearest(bullet, player->center, ENV_NEAREST_BULLETS, slots);
+    for (int n = 0; n < found; n++)
+    {
+        int i = slots[n];
+        float *o = out + n * ENV_BULLET_FLOATS;
+        o[0] = (bullet->x[i] - player->center.x) / screenWidth;
+        o[1] = (bullet->y[i] - player->center.y) / screenHeight;
+        o[2] = bullet->vx[i] / speedUnit;
+        o[3] = bullet->vy[i] / speedUnit;
+    }
+}
+
+static void TopUpAsteroids(batch_env_t *env, world_t *world)
+{
+    while (world->asteroid.pool.count < env->config.minAsteroids && SpawnRandomAsteroid(world))
+        ;
+}
+
+static void ResetEnv(batch_env_t *env, int index)
+{
+    world_config_t config = env->config.world;
+    config.seed += index + (unsigned int)env->episodes[index] * env->count;
+    world_t *world = PlaceNewWorld(config, BatchEnvWorld(env, index));
+    TopUpAsteroids(env, world);
+    env->lastScore[index] = 0;
+    env->episodeTicks[index] = 0;
+}
+
+typedef struct step_job_t
+{
+    batch_env_t *env;
+    const uint8_t *actions;
+    float *observations;
+    float *rewards;
+    uint8_t *dones;
+} step_job_t;
+
+static void ResetJob(void *context, int begin, int end, int worker)
+{
+    step_job_t *job = context;
+    for (int i = begin; i < end; i++)
+    {
+        job->env->episodes[i] = 0;
+        ResetEnv(job->env, i);
+        if (job->observations != NULL)
+            WriteObservation(BatchEnvWorld(job->env, i), job->observations + (size_t)i * ENV_OBSERVATION_SIZE);
+    }
+    (void)worker;
+}
+
+static void StepJob(void *context, int begin, int end, int worker)
+{
+    step_job_t *job = context;
+    batch_env_t *env = job->env;
+    for (int i = begin; i < end; i++)
+    {
+        world_t *world = BatchEnvWorld(env, i);
+        TopUpAsteroids(env, world);
+        StepWorld(world, job->actions[i]);
+        float reward = world->score - env->lastScore[i];
+        env->lastScore[i] = world->score;
+        env->episodeTicks[i]++;
+
+        bool died = world->state == gameStateDead;
+        bool done = died || (env->config.maxEpisodeTicks > 0 && env->episodeTicks[i] >= env->config.maxEpisodeTicks);
+        if (died)
+            reward -= envDeathPenalty;
+        if (done)
+        {
+            env->episodes[i]++;
+            ResetEnv(env, i);
+        }
+        if (job->rewards != NULL)
+            job->rewards[i] = reward;
+        if (job->dones != NULL)
+            job->dones[i] = done;
+        WriteObservation(world, job->observations + (size_t)i * ENV_OBSERVATION_SIZE);
+    }
+    (void)worker;
+}
+
+void ResetBatchEnv(batch_env_t *env, float *observations)
+{
+    step_job_t job = {.env = env, .observations = observations};
+    ParallelFor(env->jobs, env->count, envGrain, ResetJob, &job);
+}
+
+void StepBatchEnv(batch_env_t *env, const uint8_t *actions, float *observations, float *rewards, uint8_t *dones)
+{
+    step_job_t job = {.env = env, .actions = actions, .observations = observations, .rewards = rewards, .dones = dones};
+    ParallelFor(env->jobs, env->count, envGrain, StepJob, &job);
+}
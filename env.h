@@ -0,0 +1,56 @@
+#ifndef ENV_H
+#define ENV_H
+
+#include "game.h"
+#include "jobs.h"
+#include <stdint.h>
+
+// many headless games stepped in lockstep for training agents. every env is a full world_t running the
+// normal simulation, all of them live back to back in one allocation. actions are input_e masks, one byte per env.
+// observations go straight into a caller buffer of count * ENV_OBSERVATION_SIZE floats, laid out per env as
+//   player:    x, y (0..1 of the screen), vx, vy (in bullet speeds, so any tick rate reads the same), cos, sin, hp, invincible, can fire
+//   asteroids: ENV_NEAREST_ASTEROIDS nearest first, each dx, dy (screens), vx, vy (bullet speeds), radius (of the max)
+//   bullets:   ENV_NEAREST_BULLETS nearest first, each dx, dy, vx, vy in the same units
+// slots without an entity are all zero.
+#define ENV_NEAREST_ASTEROIDS 8
+#define ENV_NEAREST_BULLETS 4
+#define ENV_PLAYER_FLOATS 9
+#define ENV_ASTEROID_FLOATS 5
+#define ENV_BULLET_FLOATS 4
+#define ENV_OBSERVATION_SIZE (ENV_PLAYER_FLOATS + ENV_NEAREST_ASTEROIDS * ENV_ASTEROID_FLOATS + \
+                              ENV_NEAREST_BULLETS * ENV_BULLET_FLOATS)
+
+extern const float envDeathPenalty; // taken off the reward of the step the player dies on
+
+typedef struct batch_env_config_t
+{
+    world_config_t world; // episode e of env i is seeded with world.seed + i + e * count
+    int minAsteroids;     // the field is topped up to this many before every step, 0 plays the normal spawns
+    int maxEpisodeTicks;  // episodes are cut off after this many steps, 0 never cuts them
+    int threads;          // 1 steps every env on the calling thread, 0 uses one thread per core
+} batch_env_config_t;
+
+typedef struct batch_env_t
+{
+    int count;
+    batch_env_config_t config;
+    size_t worldBytes;      // stride between worlds
+    unsigned char *worlds;  // the one allocation, also holds the per env counters below
+    int *lastScore;         // score at the previous step, rewards are its change
+    int *episodeTicks;
+    int *episodes;          // finished so far, picks the next seed
+    job_system_t *jobs;     // NULL when config.threads is 1
+} batch_env_t;
+
+batch_env_config_t DefaultBatchEnvConfig(void);
+batch_env_t *CreateBatchEnv(int count, batch_env_config_t config);
+void DestroyBatchEnv(batch_env_t *env);
+world_t *BatchEnvWorld(const batch_env_t *env, int index);
+
+// restarts every env from episode 0 and writes their first observations, observations may be NULL
+void ResetBatchEnv(batch_env_t *env, float *observations);
+// steps every env once with its action. rewards and dones (count each) may be NULL. an env whose player died
+// or ran out of ticks reports done and is restarted right away, its observation is then the new episode's first
+void StepBatchEnv(batch_env_t *env, const uint8_t *actions, float *observations, float *rewards, uint8_t *dones);
+
+#endif
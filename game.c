@@ -0,0 +1,1054 @@
+#include "game.h"
+#include "kernels.h"
+#include "jobs.h"
+#include "polygon.h"
+#include "rng.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+const int screenWidth = 1920;
+const int screenHeight = 1080;
+const float drag = 0.99f;     // default drag when not pressing W
+const float brakeDrag = 0.9f; // drag when pressing S
+const int defaultMaxBullets = 300;      // bullet pool size, shots are skipped while it is full
+const float defaultFireCooldown = 0.1f; // time between shots in seconds
+const float bulletSpeed = 15;
+const float bulletSize = 5;
+const int defaultMaxAsteroids = 256; // asteroid pool size, spawns and splits are skipped while it is full
+const int defaultFieldAsteroids = 2000;
+const float timeBetweenAsteroidSpawn = 10;
+const float asteroidSpeedConstant = 200; // min speed will be this/max size, max speed will be this/min size
+const int asteroidMaxSize = 100;
+const int asteroidMinSize = 30;
+const float invincibleDuration = 2; // invincibility time after taking damage in seconds
+const int maxHitsPerBullet = 4;     // overlaps remembered per bullet, more falls back to a serial lookup
+const float asteroidJaggedness = 0.3f;
+const int defaultTickRate = 60;
+const int minTickRate = 20;
+
+#define SCATTER_DRAWS 256 // field asteroids whose numbers are drawn in one go
+
+// items per job for the parallel passes
+const int integrateGrain = 512; // blocks of ENTITY_LANES
+const int binGrain = 4096;
+const int hitGrain = 32;
+
+uint32_t AsteroidShapeSeed(handle_t asteroid)
+{
+    // only the low byte of the generation is sent over the network
+    return ((uint32_t)asteroid.id * 2654435761u) ^ ((asteroid.generation & 0xff) * 40503u);
+}
+
+void MakeAsteroidShape(Vector2 *shape, uint32_t seed, float radius)
+{
+    uint32_t h = seed ^ 0x9e3779b9u;
+    if (h == 0)
+        h = 1; // xorshift never leaves zero
+    angle_t spacing = (angle_t)(UINT32_MAX / ASTEROID_VERTICES);
+    for (int i = 0; i < ASTEROID_VERTICES; i++)
+    {
+        h ^= h << 13;
+        h ^= h >> 17;
+        h ^= h << 5;
+        // corners keep to their own quarter of the spacing, so the outline stays star shaped around the center
+        angle_t jitter = h % (spacing / 4);
+        float depth = (float)((h >> 16) & 255) / 255;
+        shape[i] = PolarOffset((Vector2){0, 0}, radius * (1 - asteroidJaggedness * depth),
+                               (angle_t)i * spacing + jitter);
+    }
+}
+
+static void ShapeAsteroid(world_t *world, int slot, uint32_t seed)
+{
+    int id = world->asteroid.pool.idOf[slot];
+    world->asteroidShapeSeed[id] = seed;
+    MakeAsteroidShape(&world->asteroidShape[id * ASTEROID_VERTICES], seed, world->asteroid.radius[slot]);
+}
+
+static uint32_t NewShapeSeed(const world_t *world, int slot)
+{
+    return AsteroidShapeSeed(PoolHandle(&world->asteroid.pool, slot));
+}
+
+// returns the new asteroid's slot, or -1 if the pool is full
+int SpawnAsteroid(world_t *world, Vector2 center, float size, angle_t angle)
+{
+    entity_array_t *asteroid = &world->asteroid;
+    int i = SpawnEntity(asteroid);
+    if (i == -1)
+        return -1;
+    float speed = asteroidSpeedConstant / size * world->tickScale;
+    asteroid->x[i] = center.x;
+    asteroid->y[i] = center.y;
+    asteroid->previousX[i] = center.x;
+    asteroid->previousY[i] = center.y;
+    asteroid->vx[i] = speed * AngleCos(angle);
+    asteroid->vy[i] = speed * AngleSin(angle);
+    asteroid->radius[i] = size;
+    asteroid->angle[i] = angle;
+    asteroid->speed[i] = speed;
+    asteroid->hp[i] = size / 5;
+    ShapeAsteroid(world, i, NewShapeSeed(world, i));
+    return i;
+}
+
+static void EmitEvent(world_t *world, world_event_t event)
+{
+    if (world->eventCount < MAX_WORLD_EVENTS)
+        world->events[world->eventCount++] = event;
+}
+
+// the integer division keeps the original spread of whole radians, 0 to 3
+angle_t SpawnAngle(uint32_t bits)
+{
+    return AngleFromRadians(bits % (int)(100 * PI) / 100);
+}
+
+// size, edge, position along it and heading, one word each
+void GetRandomAsteroidSpawn(entity_t *asteroid, random_block_t random)
+{
+    float size = (random.word[0] % (asteroidMaxSize - asteroidMinSize + 1)) + asteroidMinSize; // picks a random value between the min and max asteroid size
+    asteroid->size = size;
+    switch (random.word[1] % 4)
+    {
+    case 0: // start in left corner
+        asteroid->center.x = -asteroid->size;
+        asteroid->center.y = random.word[2] % screenHeight;
+        asteroid->angle = SpawnAngle(random.word[3]) - QUARTER_TURN; // (-90)-90 degrees
+        break;
+
+    case 1: // start in right corner
+        asteroid->center.x = screenWidth + size;
+        asteroid->center.y = random.word[2] % screenHeight;
+        asteroid->angle = SpawnAngle(random.word[3]) + QUARTER_TURN; // 90-270 degrees
+        break;
+
+    case 2: // start in bottom
+        asteroid->center.x = random.word[2] % screenWidth;
+        asteroid->center.y = -size;
+        asteroid->angle = SpawnAngle(random.word[3]); // 0-180 degrees
+        break;
+
+    case 3: // start in top
+        asteroid->center.x = random.word[2] % screenWidth;
+        asteroid->center.y = screenHeight + size;
+        asteroid->angle = SpawnAngle(random.word[3]) + HALF_TURN; // 180-360 degrees
+        break;
+    }
+}
+
+bool SpawnRandomAsteroid(world_t *world)
+{
+    entity_t spawn;
+    random_key_t key = RandomKey(world->config.seed, randomStreamAsteroidSpawn);
+    GetRandomAsteroidSpawn(&spawn, RandomBlock(key, world->spawnSerial++, (uint32_t)world->tick, 0));
+    return SpawnAsteroid(world, spawn.center, spawn.size, spawn.angle) != -1;
+}
+
+// checks if astroid should spawn, and spawns one if it should
+void HandleAstroidSpawn(world_t *world)
+{
+    if (world->timeSinceLastAsteroidSpawn >= timeBetweenAsteroidSpawn)
+    {
+        SpawnRandomAsteroid(world);
+        world->timeSinceLastAsteroidSpawn = 0;
+    }
+}
+
+void UpdatePlayerPosition(entity_t *player)
+{
+    player->center.x += player->velocity.x;
+    player->center.y += player->velocity.y;
+}
+
+void SpawnBullet(entity_array_t *bullet, angle_t playerAngle, Vector2 playerFront, float speed)
+{
+    int i = SpawnEntity(bullet);
+    if (i == -1)
+        return;
+    bullet->angle[i] = playerAngle;
+    bullet->speed[i] = speed;
+    bullet->vx[i] = speed * AngleCos(playerAngle);
+    bullet->vy[i] = speed * AngleSin(playerAngle);
+    bullet->x[i] = playerFront.x;
+    bullet->y[i] = playerFront.y;
+    bullet->previousX[i] = playerFront.x;
+    bullet->previousY[i] = playerFront.y;
+    bullet->radius[i] = bulletSize;
+    bullet->hp[i] = 1;
+}
+
+static void ShipCorners(entity_t player, Vector2 *a, Vector2 *b, Vector2 *c)
+{
+    *a = PolarOffset(player.center, 2 * player.size / 3, player.angle - THIRD_TURN);
+    *b = PolarOffset(player.center, 2 * player.size / 3, player.angle + THIRD_TURN);
+    *c = PolarOffset(player.center, player.size, player.angle);
+}
+
+void CalculatePlayerPosition(world_t *world)
+{
+    ShipCorners(world->player, &world->triangleA, &world->triangleB, &world->triangleC);
+}
+
+Vector2 PredictPlayerTriangle(const world_t *world, unsigned int input, float alpha, Vector2 *a, Vector2 *b,
+                              Vector2 *c)
+{
+    entity_t player = world->player;
+    int32_t turn = 0;
+    if (input & inputLeft)
+        turn -= (int32_t)player.rotation;
+    if (input & inputRight)
+        turn += (int32_t)player.rotation;
+    player.angle += (angle_t)(int32_t)lroundf(turn * alpha);
+    Vector2 velocity = player.velocity;
+    if (input & inputThrust)
+        velocity = (Vector2){player.speed * AngleCos(player.angle), player.speed * AngleSin(player.angle)};
+    player.center.x += velocity.x * alpha;
+    player.center.y += velocity.y * alpha;
+    ShipCorners(player, a, b, c);
+    return player.center;
+}
+
+void HandlePlayerInput(world_t *world, unsigned int input)
+{
+    entity_t *player = &world->player;
+    if (input & inputLeft)
+        player->angle -= player->rotation;
+    if (input & inputRight)
+        player->angle += player->rotation;
+    if (input & inputThrust)
+    {
+        player->velocity.x = player->speed * AngleCos(player->angle);
+        player->velocity.y = player->speed * AngleSin(player->angle);
+        EmitEvent(world, (world_event_t){.type = worldEventThrust, .position = player->center,
+                                         .velocity = player->velocity, .size = player->size, .angle = player->angle});
+    }
+    else
+    {
+        // drag is per tick at defaultTickRate, compounding it over tickScale of those keeps the same slowdown per second
+        float tickDrag = powf(drag, world->tickScale);
+        player->velocity.x *= tickDrag;
+        player->velocity.y *= tickDrag;
+    }
+    if (input & inputBrake)
+    {
+        float tickBrakeDrag = powf(brakeDrag, world->tickScale);
+        player->velocity.x *= tickBrakeDrag;
+        player->velocity.y *= tickBrakeDrag;
+    }
+    if (input & inputFire)
+    {
+        if (world->timeSinceLastShot >= world->fireCooldown)
+        {
+            SpawnBullet(&world->bullet, player->angle, world->triangleC, bulletSpeed * world->tickScale);
+            world->timeSinceLastShot = 0;
+        }
+    }
+}
+
+void HandleInvincibility(world_t *world)
+{
+    if (world->playerIsInvincible)
+    {
+        world->timeSpentInvincible += world->tickTime;
+        // this will make the ship switch between white and red faster and faster
+        world->invincibleColorSwitchCheck += powf(20, (world->timeSpentInvincible / invincibleDuration)) * world->tickScale;
+    }
+    // if invincible duration is over
+    if (world->timeSpentInvincible >= invincibleDuration)
+    {
+        world->playerIsInvincible = false;
+        world->playerIsWhite = false;
+        world->timeSpentInvincible = 0;
+        world->invincibleColorSwitchCheck = 0;
+    }
+    if (world->playerIsInvincible && world->invincibleColorSwitchCheck >= 60)
+    {
+        world->playerIsWhite = !world->playerIsWhite;
+        world->invincibleColorSwitchCheck -= 60;
+    }
+}
+
+void UpdateTimeVariables(world_t *world)
+{
+    world->timeSinceLastShot += world->tickTime;
+    world->timeSinceLastAsteroidSpawn += world->tickTime;
+}
+
+// low when the range is empty
+static float ClampToRange(float value, float low, float high)
+{
+    return fmaxf(low, fminf(value, high));
+}
+
+static bool HasChunks(const world_t *world)
+{
+    return world->field.columns > 0;
+}
+
+Vector2 FieldSize(const world_t *world)
+{
+    if (!HasChunks(world))
+        return (Vector2){screenWidth, screenHeight};
+    return (Vector2){world->field.width, world->field.height};
+}
+
+Vector2 PlayerCenterAt(const world_t *world, float alpha)
+{
+    Vector2 from = world->previousPlayerCenter;
+    Vector2 to = world->player.center;
+    return (Vector2){from.x + (to.x - from.x) * alpha, from.y + (to.y - from.y) * alpha};
+}
+
+Rectangle WorldView(const world_t *world, float alpha)
+{
+    Vector2 field = FieldSize(world);
+    Vector2 center = PlayerCenterAt(world, alpha);
+    return (Rectangle){ClampToRange(center.x - screenWidth / 2.0f, 0, field.x - screenWidth),
+                       ClampToRange(center.y - screenHeight / 2.0f, 0, field.y - screenHeight),
+                       screenWidth, screenHeight};
+}
+
+void Update(world_t *world, unsigned int input)
+{
+    ProfileBegin(world->profiler, phaseInput);
+    UpdateTimeVariables(world);
+    HandleInvincibility(world);
+    HandlePlayerInput(world, input);
+    world->previousPlayerCenter = world->player.center;
+    UpdatePlayerPosition(&world->player);
+    if (HasChunks(world))
+    {
+        // a chunked field has walls, the classic one lets the ship fly off the screen
+        Vector2 field = FieldSize(world);
+        world->player.center.x = ClampToRange(world->player.center.x, 0, field.x);
+        world->player.center.y = ClampToRange(world->player.center.y, 0, field.y);
+    }
+    world->previousTriangleA = world->triangleA;
+    world->previousTriangleB = world->triangleB;
+    world->previousTriangleC = world->triangleC;
+    CalculatePlayerPosition(world);
+    ProfileEnd(world->profiler, phaseInput);
+
+    // a chunked field is filled when the game starts
+    ProfileBegin(world->profiler, phaseSpawn);
+    if (!HasChunks(world))
+        HandleAstroidSpawn(world);
+    ProfileEnd(world->profiler, phaseSpawn);
+}
+
+// the player's chunk and its neighbours, cut off at the field's edges. a chunk is wider than half the screen plus
+// the largest asteroid, so nothing parked outside this can reach into view
+static void UpdateActiveArea(world_t *world)
+{
+    if (!HasChunks(world))
+    {
+        world->activeArea = (Rectangle){0, 0, screenWidth, screenHeight};
+        return;
+    }
+    const chunk_field_t *field = &world->field;
+    int chunk = ChunkAt(field, world->player.center.x, world->player.center.y);
+    int column = chunk % field->columns;
+    int row = chunk / field->columns;
+    int left = column > 0 ? column - 1 : 0;
+    int top = row > 0 ? row - 1 : 0;
+    int right = column + 1 < field->columns ? column + 1 : column;
+    int bottom = row + 1 < field->rows ? row + 1 : row;
+    world->activeArea = (Rectangle){left * chunkSize, top * chunkSize,
+                                    (right - left + 1) * chunkSize, (bottom - top + 1) * chunkSize};
+}
+
+// bounces active asteroids off the field's walls, the same rule parked ones follow, and parks every one that drifted
+// further outside the active area than the largest asteroid is wide
+static void ParkStrayAsteroids(world_t *world)
+{
+    entity_array_t *a = &world->asteroid;
+    Vector2 field = FieldSize(world);
+    Rectangle area = world->activeArea;
+    for (int i = 0; i < a->pool.count; i++)
+    {
+        if (a->x[i] < 0 || a->x[i] > field.x)
+        {
+            a->x[i] = a->x[i] < 0 ? -a->x[i] : 2 * field.x - a->x[i];
+            a->vx[i] = -a->vx[i];
+        }
+        if (a->y[i] < 0 || a->y[i] > field.y)
+        {
+            a->y[i] = a->y[i] < 0 ? -a->y[i] : 2 * field.y - a->y[i];
+            a->vy[i] = -a->vy[i];
+        }
+        if (a->x[i] >= area.x - asteroidMaxSize && a->x[i] <= area.x + area.width + asteroidMaxSize &&
+            a->y[i] >= area.y - asteroidMaxSize && a->y[i] <= area.y + area.height + asteroidMaxSize)
+            continue;
+        parked_asteroid_t parked = {.x = a->x[i], .y = a->y[i], .vx = a->vx[i], .vy = a->vy[i],
+                                    .radius = a->radius[i], .speed = a->speed[i], .hp = a->hp[i],
+                                    .angle = a->angle[i], .shapeSeed = world->asteroidShapeSeed[a->pool.idOf[i]]};
+        if (ParkAsteroid(&world->field, parked, world->tick)) // when the field is full it just stays active
+            a->alive[i] = 0;
+    }
+    SweepDeadEntities(a);
+}
+
+static void SpawnParked(world_t *world, const parked_asteroid_t *parked)
+{
+    entity_array_t *asteroid = &world->asteroid;
+    int i = SpawnEntity(asteroid);
+    asteroid->x[i] = parked->x;
+    asteroid->y[i] = parked->y;
+    asteroid->previousX[i] = parked->x;
+    asteroid->previousY[i] = parked->y;
+    asteroid->vx[i] = parked->vx;
+    asteroid->vy[i] = parked->vy;
+    asteroid->radius[i] = parked->radius;
+    asteroid->angle[i] = parked->angle;
+    asteroid->speed[i] = parked->speed;
+    asteroid->hp[i] = parked->hp;
+    ShapeAsteroid(world, i, parked->shapeSeed);
+}
+
+// everything parked in the active chunks joins the stepped asteroids, whether the area just moved over it or it
+// flew in on its own. whatever does not fit in the pool waits for a later tick
+static void WakeActiveChunks(world_t *world)
+{
+    chunk_field_t *field = &world->field;
+    Rectangle area = world->activeArea;
+    int left = (int)(area.x / chunkSize);
+    int top = (int)(area.y / chunkSize);
+    int right = left + (int)(area.width / chunkSize);
+    int bottom = top + (int)(area.height / chunkSize);
+    parked_asteroid_t woken[64];
+    for (int row = top; row < bottom; row++)
+    {
+        for (int column = left; column < right; column++)
+        {
+            int chunk = row * field->columns + column;
+            while (field->chunkHead[chunk] != -1)
+            {
+                int room = world->asteroid.pool.capacity - world->asteroid.pool.count;
+                int count = UnparkChunk(field, chunk, world->tick, woken, room < 64 ? room : 64);
+                if (count == 0)
+                    return;
+                for (int n = 0; n < count; n++)
+                    SpawnParked(world, &woken[n]);
+            }
+        }
+    }
+}
+
+// drops fieldAsteroids parked asteroids anywhere but around the player's start
+static void ScatterAsteroids(world_t *world)
+{
+    Vector2 field = FieldSize(world);
+    Vector2 start = world->player.center;
+    random_key_t key = RandomKey(world->config.seed, randomStreamField);
+    random_block_t random[SCATTER_DRAWS];
+    int placed = 0;
+    for (int attempt = 0; placed < world->config.fieldAsteroids && attempt < world->config.fieldAsteroids * 4; attempt++)
+    {
+        int n = attempt % SCATTER_DRAWS;
+        if (n == 0)
+            FillRandomBlocks(key, world->spawnSerial + attempt, 0, 0, random, SCATTER_DRAWS);
+        float size = (random[n].word[0] % (asteroidMaxSize - asteroidMinSize + 1)) + asteroidMinSize;
+        float x = random[n].word[1] % (int)field.x;
+        float y = random[n].word[2] % (int)field.y;
+        angle_t angle = random[n].word[3];
+        uint32_t seed = random[n].word[0] ^ random[n].word[3]; // the outline only needs to differ between asteroids
+        if (fabsf(x - start.x) < screenWidth / 2.0f + size && fabsf(y - start.y) < screenHeight / 2.0f + size)
+            continue;
+        float speed = asteroidSpeedConstant / size * world->tickScale;
+        parked_asteroid_t parked = {.x = x, .y = y, .vx = speed * AngleCos(angle), .vy = speed * AngleSin(angle),
+                                    .radius = size, .speed = speed, .hp = size / 5, .angle = angle, .shapeSeed = seed};
+        if (!ParkAsteroid(&world->field, parked, world->tick))
+            break;
+        placed++;
+    }
+    world->spawnSerial += world->config.fieldAsteroids * 4; // the next game gets a different field
+}
+
+typedef struct integrate_job_t
+{
+    entity_array_t *entities;
+    Rectangle bounds;
+    float margin;
+} integrate_job_t;
+
+static void IntegrateJob(void *context, int begin, int end, int worker)
+{
+    integrate_job_t *job = context;
+    entity_array_t *e = job->entities;
+    int first = begin * ENTITY_LANES;
+    int count = (end - begin) * ENTITY_LANES;
+    Rectangle b = job->bounds;
+    CullEntities(e->x + first, e->y + first, e->radius + first, e->alive + first, count,
+                 b.x, b.y, b.x + b.width, b.y + b.height, job->margin);
+    IntegrateEntities(e->x + first, e->y + first, e->previousX + first, e->previousY + first, e->vx + first,
+                      e->vy + first, e->alive + first, count);
+    (void)worker;
+}
+
+// culls and moves one entity array across the job system, then frees whatever left bounds grown by margin
+void IntegrateEntityArray(world_t *world, entity_array_t *entities, Rectangle bounds, float margin)
+{
+    integrate_job_t job = {.entities = entities, .bounds = bounds, .margin = margin};
+    ParallelFor(world->jobs, EntityLanes(entities) / ENTITY_LANES, integrateGrain, IntegrateJob, &job);
+    SweepDeadEntities(entities);
+}
+
+// moves every live bullet and asteroid that is still on screen, anything that left it is freed
+void UpdateEntities(world_t *world)
+{
+    UpdateActiveArea(world);
+    IntegrateEntityArray(world, &world->bullet, world->activeArea, 0);
+    if (HasChunks(world))
+    {
+        // asteroids bounce off a chunked field's walls right after moving, so none is ever culled here. the ones
+        // that leave the active area are parked instead
+        Vector2 field = FieldSize(world);
+        IntegrateEntityArray(world, &world->asteroid, (Rectangle){0, 0, field.x, field.y}, asteroidMaxSize);
+        world->tick++;
+        ParkStrayAsteroids(world);
+        AdvanceChunkField(&world->field, world->tick);
+        WakeActiveChunks(world);
+    }
+    else
+    {
+        // + 5 since starting pos will be -asteroid.size at times
+        IntegrateEntityArray(world, &world->asteroid, world->activeArea, 5);
+        world->tick++;
+    }
+}
+
+void SplitAsteroid(world_t *world, int parent, angle_t bulletAngle)
+{
+    entity_array_t *asteroid = &world->asteroid;
+    Vector2 center = {asteroid->x[parent], asteroid->y[parent]};
+    float size = asteroid->radius[parent];
+    float newSpeed = asteroid->speed[parent] * 2;
+    float newSize = size / 2;
+    angle_t childAngles[2] = {bulletAngle + QUARTER_TURN, bulletAngle - QUARTER_TURN};
+    for (int k = 0; k < 2; k++)
+    {
+        angle_t angle = childAngles[k];
+        int i = SpawnEntity(asteroid);
+        if (i == -1)
+            return;
+        Vector2 position = PolarOffset(center, size / 2, angle);
+        asteroid->x[i] = position.x;
+        asteroid->y[i] = position.y;
+        asteroid->previousX[i] = position.x;
+        asteroid->previousY[i] = position.y;
+        asteroid->vx[i] = newSpeed * AngleCos(angle);
+        asteroid->vy[i] = newSpeed * AngleSin(angle);
+        asteroid->radius[i] = newSize;
+        asteroid->angle[i] = angle;
+        asteroid->speed[i] = newSpeed;
+        asteroid->hp[i] = newSize / 5;
+        ShapeAsteroid(world, i, NewShapeSeed(world, i));
+    }
+}
+
+static void BinAsteroidsJob(void *context, int begin, int end, int worker)
+{
+    world_t *world = context;
+    for (int i = begin; i < end; i++)
+        SpatialHashSetItem(&world->asteroidGrid, i, (Vector2){world->asteroid.x[i], world->asteroid.y[i]});
+    (void)worker;
+}
+
+static void GatherGridJob(void *context, int begin, int end, int worker)
+{
+    world_t *world = context;
+    for (int k = begin; k < end; k++)
+    {
+        int i = world->asteroidGrid.cellItems[k];
+        world->gridX[k] = world->asteroid.x[i];
+        world->gridY[k] = world->asteroid.y[i];
+        world->gridRadius[k] = world->asteroid.radius[i];
+        world->gridVX[k] = world->asteroid.vx[i];
+        world->gridVY[k] = world->asteroid.vy[i];
+    }
+    (void)worker;
+}
+
+void BuildAsteroidGrid(world_t *world)
+{
+    float margin = asteroidMaxSize + 5;
+    MoveSpatialHash(&world->asteroidGrid, (Vector2){world->activeArea.x - margin, world->activeArea.y - margin});
+    int count = world->asteroid.pool.count;
+    ParallelFor(world->jobs, count, binGrain, BinAsteroidsJob, world);
+    FinishSpatialHash(&world->asteroidGrid, count);
+    ParallelFor(world->jobs, count, binGrain, GatherGridJob, world);
+}
+
+// the grid cell around the middle of a sweep. anything the sweep can touch is in its 3x3 neighbourhood as long as
+// radius + half the step + the fastest asteroid's step + asteroidMaxSize stays within the cell size
+static void SweepCell(const spatial_hash_t *grid, Vector2 center, Vector2 step, int *column, int *row)
+{
+    SpatialHashCellOf(grid, (Vector2){center.x - step.x / 2, center.y - step.y / 2}, column, row);
+}
+
+// exact test run on an asteroid slot once the bounding circles were found to meet
+typedef bool (*asteroid_test_t)(const world_t *world, int asteroid, const void *context);
+
+// lowest asteroid slot that is alive, touched by the circle moving by step and ending at center and passes test,
+// or -1. picking the lowest slot keeps results identical to testing every asteroid in order
+int FirstAsteroidHit(const world_t *world, Vector2 center, Vector2 step, float radius, asteroid_test_t test,
+                     const void *context)
+{
+    const spatial_hash_t *grid = &world->asteroidGrid;
+    int column, row;
+    SweepCell(grid, center, step, &column, &row);
+
+    int first = -1;
+    for (int y = row - 1; y <= row + 1; y++)
+    {
+        if (y < 0 || y >= grid->rows)
+            continue;
+        for (int x = column - 1; x <= column + 1; x++)
+        {
+            if (x < 0 || x >= grid->columns)
+                continue;
+            int cell = y * grid->columns + x;
+            int end = grid->cellStart[cell + 1];
+            int k = grid->cellStart[cell];
+            while ((k = FirstSweptOverlap(center.x, center.y, step.x, step.y, radius, world->gridX, world->gridY,
+                                           world->gridVX, world->gridVY, world->gridRadius, k, end)) != -1)
+            {
+                int i = grid->cellItems[k];
+                if (first != -1 && i >= first)
+                    break; // cells are sorted, nothing lower left in this one
+                if (world->asteroid.alive[i] && test(world, i, context))
+                {
+                    first = i;
+                    break;
+                }
+                k++; // destroyed earlier this tick or only the bounding circles met, keep looking
+            }
+        }
+    }
+    return first;
+}
+
+// writes up to max asteroid slots the sweep touches into hits in ascending order, ignoring alive.
+// returns how many it touches in total, which can be more than max
+int CollectAsteroidHits(const world_t *world, Vector2 center, Vector2 step, float radius, int *hits, int max)
+{
+    const spatial_hash_t *grid = &world->asteroidGrid;
+    int column, row;
+    SweepCell(grid, center, step, &column, &row);
+
+    int found = 0;
+    for (int y = row - 1; y <= row + 1; y++)
+    {
+        if (y < 0 || y >= grid->rows)
+            continue;
+        for (int x = column - 1; x <= column + 1; x++)
+        {
+            if (x < 0 || x >= grid->columns)
+                continue;
+            int cell = y * grid->columns + x;
+            int end = grid->cellStart[cell + 1];
+            int k = grid->cellStart[cell];
+            while ((k = FirstSweptOverlap(center.x, center.y, step.x, step.y, radius, world->gridX, world->gridY,
+                                           world->gridVX, world->gridVY, world->gridRadius, k, end)) != -1)
+            {
+                if (found < max)
+                {
+                    // insertion sort, there are only ever a handful
+                    int i = grid->cellItems[k];
+                    int n = found;
+                    for (; n > 0 && hits[n - 1] > i; n--)
+                        hits[n] = hits[n - 1];
+                    hits[n] = i;
+                }
+                found++;
+                k++;
+            }
+        }
+    }
+    return found;
+}
+
+// the outline's fan triangle from the center through corners i and i + 1, offset by position
+static void FanTriangle(const Vector2 *shape, int i, Vector2 position, Vector2 *triangle)
+{
+    Vector2 from = shape[i];
+    Vector2 to = shape[(i + 1) % ASTEROID_VERTICES];
+    triangle[0] = position;
+    triangle[1] = (Vector2){position.x + from.x, position.y + from.y};
+    triangle[2] = (Vector2){position.x + to.x, position.y + to.y};
+}
+
+static const Vector2 *AsteroidShape(const world_t *world, int asteroid)
+{
+    return &world->asteroidShape[world->asteroid.pool.idOf[asteroid] * ASTEROID_VERTICES];
+}
+
+static bool TriangleTouchesOutline(const Vector2 *triangle, const Vector2 *shape, Vector2 position)
+{
+    for (int i = 0; i < ASTEROID_VERTICES; i++)
+    {
+        Vector2 fan[3];
+        FanTriangle(shape, i, position, fan);
+        if (ConvexOverlap(triangle, 3, fan, 3))
+            return true;
+    }
+    return false;
+}
+
+static bool CircleTouchesOutline(Vector2 center, float radius, const Vector2 *shape)
+{
+    for (int i = 0; i < ASTEROID_VERTICES; i++)
+    {
+        Vector2 fan[3];
+        FanTriangle(shape, i, (Vector2){0, 0}, fan);
+        if (CircleConvexOverlap(center, radius, fan, 3))
+            return true;
+    }
+    return false;
+}
+
+// the player's triangle against the outline where both ended up and halfway through the tick
+static bool PlayerTouchesAsteroid(const world_t *world, int asteroid, const void *context)
+{
+    const entity_array_t *a = &world->asteroid;
+    const Vector2 *shape = AsteroidShape(world, asteroid);
+    Vector2 end[3] = {world->triangleA, world->triangleB, world->triangleC};
+    if (TriangleTouchesOutline(end, shape, (Vector2){a->x[asteroid], a->y[asteroid]}))
+        return true;
+    Vector2 middle[3] = {
+        {(world->previousTriangleA.x + world->triangleA.x) / 2, (world->previousTriangleA.y + world->triangleA.y) / 2},
+        {(world->previousTriangleB.x + world->triangleB.x) / 2, (world->previousTriangleB.y + world->triangleB.y) / 2},
+        {(world->previousTriangleC.x + world->triangleC.x) / 2, (world->previousTriangleC.y + world->triangleC.y) / 2}};
+    Vector2 halfway = {a->x[asteroid] - a->vx[asteroid] / 2, a->y[asteroid] - a->vy[asteroid] / 2};
+    (void)context;
+    return TriangleTouchesOutline(middle, shape, halfway);
+}
+
+// in the asteroid's frame the bullet moves along a straight segment. it hits when the path crosses the outline or
+// the bullet's circle touches it at the start, middle or end of the tick
+static bool BulletTouchesAsteroid(const world_t *world, int asteroid, const void *context)
+{
+    int b = *(const int *)context;
+    const entity_array_t *bullet = &world->bullet;
+    const entity_array_t *a = &world->asteroid;
+    const Vector2 *shape = AsteroidShape(world, asteroid);
+    Vector2 end = {bullet->x[b] - a->x[asteroid], bullet->y[b] - a->y[asteroid]};
+    Vector2 start = {end.x - (bullet->vx[b] - a->vx[asteroid]), end.y - (bullet->vy[b] - a->vy[asteroid])};
+    Vector2 middle = {(start.x + end.x) / 2, (start.y + end.y) / 2};
+    float radius = bullet->radius[b];
+    if (CircleTouchesOutline(end, radius, shape) || CircleTouchesOutline(middle, radius, shape) ||
+        CircleTouchesOutline(start, radius, shape))
+        return true;
+    for (int i = 0; i < ASTEROID_VERTICES; i++)
+        if (SegmentsCross(start, end, shape[i], shape[(i + 1) % ASTEROID_VERTICES]))
+            return true;
+    return false;
+}
+
+// bounding circles through the grid, then the outlines of whatever they found. a bullet with more candidates than
+// fit keeps the raw count and is resolved serially
+static void FindBulletHitsJob(void *context, int begin, int end, int worker)
+{
+    world_t *world = context;
+    const entity_array_t *bullet = &world->bullet;
+    for (int b = begin; b < end; b++)
+    {
+        int *hits = &world->bulletHits[b * maxHitsPerBullet];
+        int count = CollectAsteroidHits(world, (Vector2){bullet->x[b], bullet->y[b]},
+                                        (Vector2){bullet->vx[b], bullet->vy[b]}, bullet->radius[b],
+                                        hits, maxHitsPerBullet);
+        if (count <= maxHitsPerBullet)
+        {
+            int kept = 0;
+            for (int n = 0; n < count; n++)
+                if (BulletTouchesAsteroid(world, hits[n], &b))
+                    hits[kept++] = hits[n];
+            count = kept;
+        }
+        world->bulletHitCount[b] = count;
+    }
+    (void)worker;
+}
+
+// the overlap tests run in parallel against the asteroids as they were at the start of the pass,
+// then the hits are applied here in bullet order, so the outcome never depends on thread timing
+void HandleCollisions(world_t *world)
+{
+    BuildAsteroidGrid(world);
+
+    // the triangle's corners are never further than size from the center, so that circle bounds it at any angle
+    if (!world->playerIsInvincible &&
+        FirstAsteroidHit(world, world->player.center, world->player.velocity, world->player.size,
+                         PlayerTouchesAsteroid, NULL) != -1)
+    {
+        world->player.hp--;
+        world->playerIsInvincible = true;
+        world->playerIsWhite = true;
+        EmitEvent(world, (world_event_t){.type = worldEventPlayerHit, .position = world->player.center,
+                                         .velocity = world->player.velocity, .size = world->player.size});
+    }
+
+    entity_array_t *bullet = &world->bullet;
+    entity_array_t *asteroid = &world->asteroid;
+    ParallelFor(world->jobs, bullet->pool.count, hitGrain, FindBulletHitsJob, world);
+
+    for (int b = 0; b < bullet->pool.count; b++)
+    {
+        int hitCount = world->bulletHitCount[b];
+        if (hitCount == 0)
+            continue;
+
+        // first overlapping asteroid an earlier bullet has not already destroyed
+        int a = -1;
+        if (hitCount > maxHitsPerBullet)
+        {
+            a = FirstAsteroidHit(world, (Vector2){bullet->x[b], bullet->y[b]}, (Vector2){bullet->vx[b], bullet->vy[b]},
+                                 bullet->radius[b], BulletTouchesAsteroid, &b);
+        }
+        else
+        {
+            for (int n = 0; n < hitCount && a == -1; n++)
+            {
+                int candidate = world->bulletHits[b * maxHitsPerBullet + n];
+                if (asteroid->alive[candidate])
+                    a = candidate;
+            }
+        }
+        if (a == -1)
+            continue;
+
+        bullet->hp[b] = 0; // the bullet is used up
+        bullet->alive[b] = 0;
+        asteroid->hp[a]--;
+        if (asteroid->hp[a] <= 0)
+        {
+            asteroid->alive[a] = 0;
+            world->score += 10;
+            bool splits = asteroid->radius[a] >= asteroidMinSize * 2;
+            EmitEvent(world, (world_event_t){.type = splits ? worldEventAsteroidSplit : worldEventAsteroidDestroyed,
+                                             .position = {asteroid->x[a], asteroid->y[a]},
+                                             .velocity = {asteroid->vx[a], asteroid->vy[a]},
+                                             .size = asteroid->radius[a]});
+            if (splits) // add 2 new asteroids from the old asteroid
+                SplitAsteroid(world, a, bullet->angle[b]);
+        }
+    }
+}
+
+void StepWorld(world_t *world, unsigned int input)
+{
+    world->eventCount = 0;
+    switch (world->state)
+    {
+    case gameStatePlaying:
+        Update(world, input);
+        ProfileBegin(world->profiler, phaseIntegration);
+        UpdateEntities(world);
+        ProfileEnd(world->profiler, phaseIntegration);
+        ProfileBegin(world->profiler, phaseCollision);
+        HandleCollisions(world);
+        SweepDeadEntities(&world->bullet);
+        SweepDeadEntities(&world->asteroid);
+        ProfileEnd(world->profiler, phaseCollision);
+        if (world->player.hp <= 0)
+            world->state = gameStateDead;
+        break;
+    case gameStateDead:
+        break;
+    }
+}
+
+void InitGame(world_t *world)
+{
+    // init player
+    Vector2 field = FieldSize(world);
+    world->player = (entity_t){.center = (Vector2){field.x / 2, field.y / 2},
+                               .velocity = (Vector2){0, 0},
+                               .angle = 0,
+                               .rotation = (angle_t)llround(AngleFromRadians(0.1) * (double)world->tickScale),
+                               .speed = 5.0f * world->tickScale,
+                               .size = 50.0f,
+                               .hp = 5};
+    world->playerIsInvincible = false;
+    world->playerIsWhite = false;
+    world->timeSpentInvincible = 0;
+    world->invincibleColorSwitchCheck = 0;
+    CalculatePlayerPosition(world);
+    world->previousTriangleA = world->triangleA;
+    world->previousTriangleB = world->triangleB;
+    world->previousTriangleC = world->triangleC;
+    world->previousPlayerCenter = world->player.center;
+
+    // init bullets
+    ClearEntities(&world->bullet);
+    world->timeSinceLastShot = 0;
+    world->fireCooldown = defaultFireCooldown;
+
+    // init asteroids
+    ClearEntities(&world->asteroid);
+    world->timeSinceLastAsteroidSpawn = 0;
+    world->tick = 0;
+    ClearChunkField(&world->field);
+    UpdateActiveArea(world);
+    if (HasChunks(world))
+    {
+        ScatterAsteroids(world);
+        WakeActiveChunks(world);
+    }
+
+    world->score = 0;
+    world->state = gameStatePlaying;
+}
+
+world_config_t DefaultWorldConfig(void)
+{
+    return (world_config_t){
+        .maxBullets = defaultMaxBullets, .maxAsteroids = defaultMaxAsteroids, .seed = 1, .tickRate = defaultTickRate};
+}
+
+world_config_t ChunkedWorldConfig(world_config_t config, int chunks, int fieldAsteroids)
+{
+    config.chunkColumns = chunks;
+    config.chunkRows = chunks;
+    config.fieldAsteroids = fieldAsteroids > 0 ? fieldAsteroids : defaultFieldAsteroids;
+    long long nearby = (long long)config.fieldAsteroids * 9 / ((long long)chunks * chunks); // in the active 3x3
+    if (nearby * 2 > config.maxAsteroids)
+        config.maxAsteroids = (int)(nearby * 2); // room for splits
+    config.maxParked = config.fieldAsteroids + config.maxAsteroids; // room for every active one to park again
+    return config;
+}
+
+// carves the entity lanes and pools out of the block that starts with the world itself.
+// returns the block's size, with a NULL base it only measures
+// the gameplay state, which is what snapshots copy
+static size_t PlaceWorld(world_t *world, unsigned char *base)
+{
+    arena_t arena = {.base = base};
+    ArenaTake(&arena, sizeof(world_t));
+    PlaceEntityArray(&world->bullet, world->config.maxBullets, &arena);
+    PlaceEntityArray(&world->asteroid, world->config.maxAsteroids, &arena);
+    world->asteroidShape = ArenaTake(&arena, world->config.maxAsteroids * ASTEROID_VERTICES * sizeof(Vector2));
+    world->asteroidShapeSeed = ArenaTake(&arena, world->config.maxAsteroids * sizeof(uint32_t));
+    bool chunked = world->config.chunkColumns > 0 && world->config.chunkRows > 0;
+    PlaceChunkField(&world->field, chunked ? world->config.chunkColumns : 0, chunked ? world->config.chunkRows : 0,
+                    chunked ? world->config.maxParked : 0, &arena);
+    return arena.used;
+}
+
+// per tick scratch placed after the state, so it shares the allocation but never ends up in a snapshot
+static size_t PlaceScratch(world_t *world, unsigned char *base, size_t stateBytes)
+{
+    int maxAsteroids = world->config.maxAsteroids;
+    arena_t arena = {.base = base, .used = stateBytes};
+    world->gridX = ArenaTake(&arena, maxAsteroids * sizeof(float));
+    world->gridY = ArenaTake(&arena, maxAsteroids * sizeof(float));
+    world->gridRadius = ArenaTake(&arena, maxAsteroids * sizeof(float));
+    world->gridVX = ArenaTake(&arena, maxAsteroids * sizeof(float));
+    world->gridVY = ArenaTake(&arena, maxAsteroids * sizeof(float));
+    world->bulletHits = ArenaTake(&arena, world->config.maxBullets * maxHitsPerBullet * sizeof(int));
+    world->bulletHitCount = ArenaTake(&arena, world->config.maxBullets * sizeof(int));
+    world->events = ArenaTake(&arena, MAX_WORLD_EVENTS * sizeof(world_event_t));
+    // a cell as wide as the largest asteroid is across, so a bullet only has to look at its 3x3 neighbourhood.
+    // with chunks it covers the largest active area and follows it around
+    float margin = asteroidMaxSize + 5;
+    Vector2 covered = {screenWidth, screenHeight};
+    if (world->config.chunkColumns > 0 && world->config.chunkRows > 0)
+        covered = (Vector2){3 * chunkSize, 3 * chunkSize};
+    PlaceSpatialHash(&world->asteroidGrid, asteroidMaxSize * 2, (Vector2){-margin, -margin},
+                     (Vector2){covered.x + margin, covered.y + margin}, maxAsteroids, &arena);
+    return arena.used;
+}
+
+size_t WorldBytes(world_config_t config)
+{
+    world_t layout = {.config = config};
+    return PlaceScratch(&layout, NULL, PlaceWorld(&layout, NULL));
+}
+
+world_t *PlaceNewWorld(world_config_t config, void *memory)
+{
+    world_t *world = memory;
+    memset(world, 0, WorldBytes(config));
+    if (config.tickRate <= 0)
+        config.tickRate = defaultTickRate;
+    world->config = config;
+    world->tickTime = 1.0f / config.tickRate;
+    world->tickScale = (float)defaultTickRate / config.tickRate;
+    world->stateBytes = PlaceWorld(world, memory);
+    PlaceScratch(world, memory, world->stateBytes);
+    InitTrig();
+    InitGame(world);
+    return world;
+}
+
+world_t *CreateWorld(world_config_t config)
+{
+    // aligned_alloc wants a multiple of the alignment, which every arena size already is
+    void *memory = aligned_alloc(ARENA_ALIGN, WorldBytes(config));
+    if (memory == NULL)
+        return NULL;
+    return PlaceNewWorld(config, memory);
+}
+
+void DestroyWorld(world_t *world)
+{
+    free(world);
+}
+
+void RestoreWorldState(world_t *world, const void *state)
+{
+    // the copied pointers may belong to another world, so every one is re-derived from this block
+    world_t view = *world;
+    memcpy(world, state, view.stateBytes);
+    PlaceWorld(world, (unsigned char *)world);
+    PlaceScratch(world, (unsigned char *)world, view.stateBytes);
+    world->jobs = view.jobs;
+    world->profiler = view.profiler;
+}
+
+static uint32_t HashBytes(uint32_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t HashEntities(uint32_t hash, const entity_array_t *entities)
+{
+    int count = entities->pool.count;
+    hash = HashBytes(hash, &count, sizeof(count));
+    hash = HashBytes(hash, entities->x, count * sizeof(float));
+    hash = HashBytes(hash, entities->y, count * sizeof(float));
+    hash = HashBytes(hash, entities->vx, count * sizeof(float));
+    hash = HashBytes(hash, entities->vy, count * sizeof(float));
+    hash = HashBytes(hash, entities->radius, count * sizeof(float));
+    hash = HashBytes(hash, entities->hp, count * sizeof(float));
+    return hash;
+}
+
+uint32_t HashWorld(const world_t *world)
+{
+    uint32_t hash = 2166136261u; // fnv-1a
+    hash = HashBytes(hash, &world->state, sizeof(world->state));
+    hash = HashBytes(hash, &world->player.center, sizeof(world->player.center));
+    hash = HashBytes(hash, &world->player.velocity, sizeof(world->player.velocity));
+    hash = HashBytes(hash, &world->player.angle, sizeof(world->player.angle));
+    hash = HashBytes(hash, &world->player.hp, sizeof(world->player.hp));
+    hash = HashBytes(hash, &world->playerIsInvincible, sizeof(world->playerIsInvincible));
+    hash = HashBytes(hash, &world->timeSpentInvincible, sizeof(world->timeSpentInvincible));
+    hash = HashBytes(hash, &world->score, sizeof(world->score));
+    hash = HashBytes(hash, &world->timeSinceLastShot, sizeof(world->timeSinceLastShot));
+    hash = HashBytes(hash, &world->timeSinceLastAsteroidSpawn, sizeof(world->timeSinceLastAsteroidSpawn));
+    hash = HashBytes(hash, &world->spawnSerial, sizeof(world->spawnSerial));
+    hash = HashBytes(hash, &world->tick, sizeof(world->tick));
+    hash = HashBytes(hash, &world->field.count, sizeof(world->field.count));
+    hash = HashEntities(hash, &world->bullet);
+    hash = HashEntities(hash, &world->asteroid);
+    return hash;
+}
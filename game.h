@@ -0,0 +1,193 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "raylib.h"
+#include "chunks.h"
+#include "entity.h"
+#include "jobs.h"
+#include "profiler.h"
+#include "spatial_hash.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+extern const int screenWidth;
+extern const int screenHeight;
+extern const float drag;      // default drag when not pressing W
+extern const float brakeDrag; // drag when pressing S
+extern const int defaultMaxBullets;      // bullet pool size, shots are skipped while it is full
+extern const float defaultFireCooldown; // time between shots in seconds
+extern const float bulletSpeed;
+extern const float bulletSize;
+extern const int defaultMaxAsteroids; // asteroid pool size, spawns and splits are skipped while it is full
+extern const int defaultFieldAsteroids; // scattered over a chunked field when none are asked for
+extern const float timeBetweenAsteroidSpawn;
+extern const float asteroidSpeedConstant; // min speed will be this/max size, max speed will be this/min size
+extern const int asteroidMaxSize;
+extern const int asteroidMinSize;
+extern const float invincibleDuration; // invincibility time after taking damage in seconds
+extern const int maxHitsPerBullet;
+extern const float asteroidJaggedness; // how far in an outline's corners may sit, as a fraction of the radius
+extern const int defaultTickRate; // ticks per second every per tick speed, turn rate and drag is tuned for
+extern const int minTickRate;     // below this one tick's movement outgrows the collision grid's cells
+
+#define ASTEROID_VERTICES 10 // corners of every asteroid outline
+#define MAX_WORLD_EVENTS 256  // per tick, later ones are dropped
+
+typedef enum game_state_e
+{
+    gameStatePlaying,
+    gameStateDead
+} game_state_e;
+
+// one bit per key, the simulation never reads the keyboard itself
+typedef enum input_e
+{
+    inputThrust = 1 << 0, // W
+    inputLeft = 1 << 1,   // A
+    inputBrake = 1 << 2,  // S
+    inputRight = 1 << 3,  // D
+    inputFire = 1 << 4    // SPACE
+} input_e;
+
+// things that happened during a tick that only matter to effects. the simulation never reads them back
+typedef enum world_event_e
+{
+    worldEventAsteroidDestroyed,
+    worldEventAsteroidSplit,
+    worldEventPlayerHit,
+    worldEventThrust
+} world_event_e;
+
+typedef struct world_event_t
+{
+    world_event_e type;
+    Vector2 position;
+    Vector2 velocity; // per tick, of whatever the event happened to
+    float size;       // radius of the asteroid, or the ship's size
+    angle_t angle;    // the ship's heading for thrust
+} world_event_t;
+
+typedef struct entity_t
+{
+    Vector2 center;
+    Vector2 velocity;
+    angle_t angle;
+    angle_t rotation; // per tick while turning, already scaled to the world's tick rate
+    float speed;
+    float size;
+    float hp;
+} entity_t;
+
+// picked when the world is created
+typedef struct world_config_t
+{
+    int maxBullets;
+    int maxAsteroids;   // the ones stepped every tick, in a chunked field only those near the player
+    unsigned int seed;  // same seed and same inputs give the same session
+    int tickRate;       // ticks per simulated second, any rate from minTickRate up plays the same game
+    int chunkColumns;   // 0 keeps the classic field of one screen, where asteroids that leave it are gone
+    int chunkRows;
+    int maxParked;      // asteroids the chunks away from the player can hold
+    int fieldAsteroids; // scattered over a chunked field when a game starts
+} world_config_t;
+
+// everything the simulation touches, owned by CreateWorld. the struct is the start of one block that also
+// holds every entity lane and pool array, so the first stateBytes bytes from the world's address are its whole
+// gameplay state. per tick scratch follows in the same block. the pointers inside it are only a view onto
+// that block and are re-derived on restore
+typedef struct world_t
+{
+    world_config_t config;
+    size_t stateBytes;
+    game_state_e state;
+    uint32_t spawnSerial;  // random spawns drawn so far in every game since the world was made, their counter
+    float tickTime;        // seconds per tick, what StepWorld advances the timers by
+    float tickScale;       // defaultTickRate / config.tickRate, every per tick amount is multiplied by it
+
+    entity_t player;
+    bool playerIsInvincible;
+    bool playerIsWhite;
+    float timeSpentInvincible;
+    float invincibleColorSwitchCheck; // will switch from white to red ship based on how long you have been invincible
+    int score;
+    Vector2 triangleA;
+    Vector2 triangleB;
+    Vector2 triangleC;
+    Vector2 previousTriangleA; // the corners a tick ago, collisions sweep from these
+    Vector2 previousTriangleB;
+    Vector2 previousTriangleC;
+    Vector2 previousPlayerCenter; // a tick ago, for drawing between ticks
+
+    entity_array_t bullet;
+    float timeSinceLastShot;
+    float fireCooldown;
+
+    entity_array_t asteroid;
+    Vector2 *asteroidShape; // ASTEROID_VERTICES offsets from the center per asteroid pool id, made at spawn
+    uint32_t *asteroidShapeSeed; // per asteroid pool id, what its outline was made from
+    float timeSinceLastAsteroidSpawn;
+
+    chunk_field_t field;  // asteroids parked away from the player, unused in the classic field
+    int32_t tick;         // ticks stepped since InitGame, parked asteroids are timed by it
+    Rectangle activeArea; // what gets stepped and collided: the chunks around the player, or the screen
+
+    // scratch, placed after the state and rebuilt every tick
+    spatial_hash_t asteroidGrid; // on screen asteroids binned by center
+    float *gridX;                // on screen asteroids copied out in grid cell order,
+    float *gridY;                // so a cell can be tested with one vector loop
+    float *gridRadius;
+    float *gridVX; // velocity, what the asteroid moved by this tick
+    float *gridVY;
+    int *bulletHits;     // maxHitsPerBullet overlapping asteroid slots per bullet, found in parallel
+    int *bulletHitCount; // overlaps per bullet, can exceed maxHitsPerBullet
+    world_event_t *events; // MAX_WORLD_EVENTS, what the last StepWorld emitted
+    int eventCount;
+
+    job_system_t *jobs; // borrowed, NULL runs every pass on the calling thread
+    profiler_t *profiler; // borrowed, NULL skips the phase timers
+} world_t;
+
+world_config_t DefaultWorldConfig(void);
+// config on a walled field of chunks x chunks chunks holding fieldAsteroids asteroids, 0 for the default count
+world_config_t ChunkedWorldConfig(world_config_t config, int chunks, int fieldAsteroids);
+world_t *CreateWorld(world_config_t config);
+void DestroyWorld(world_t *world);
+// bytes one world occupies, state and scratch together, always a multiple of ARENA_ALIGN
+size_t WorldBytes(world_config_t config);
+// builds a world in caller owned memory of WorldBytes(config) bytes aligned to ARENA_ALIGN, nothing else is
+// allocated. such a world is released with its memory rather than DestroyWorld
+world_t *PlaceNewWorld(world_config_t config, void *memory);
+// overwrites the world with stateBytes copied from a world created with the same config
+void RestoreWorldState(world_t *world, const void *state);
+void InitGame(world_t *world);
+// recomputes the player's triangle from its center, angle and size
+void CalculatePlayerPosition(world_t *world);
+// outline seed of the asteroid the handle was taken from, so a client can rebuild it from a snapshot
+uint32_t AsteroidShapeSeed(handle_t asteroid);
+// writes an outline, the same seed always gives the same one. corners go counterclockwise around the center and
+// never reach further out than radius, so the circle stays a safe bound
+void MakeAsteroidShape(Vector2 *shape, uint32_t seed, float radius);
+// size of the field, the screen unless the world has chunks
+Vector2 FieldSize(const world_t *world);
+// the screen sized rect a camera on the player shows, kept inside the field. alpha places the player between the
+// previous tick (0) and the latest one (1)
+Rectangle WorldView(const world_t *world, float alpha);
+// where the player is drawn alpha of the way from the previous tick to the latest one
+Vector2 PlayerCenterAt(const world_t *world, float alpha);
+// the ship alpha of a tick past the latest one, turned and pushed by input the way the next tick would. only for
+// drawing input read after the last tick, the world is left alone. returns the center the corners are placed around
+Vector2 PredictPlayerTriangle(const world_t *world, unsigned int input, float alpha, Vector2 *a, Vector2 *b,
+                              Vector2 *c);
+// advances the world by one tick of tickTime seconds, input is a mask of input_e bits. replaces events with
+// the ones from this tick
+void StepWorld(world_t *world, unsigned int input);
+// drops one asteroid in from a random screen edge, false if the pool is full
+bool SpawnRandomAsteroid(world_t *world);
+// an asteroid of radius size at center heading along angle. returns its slot, or -1 if the pool is full
+int SpawnAsteroid(world_t *world, Vector2 center, float size, angle_t angle);
+// a bullet at playerFront flying along playerAngle, skipped if the pool is full
+void SpawnBullet(entity_array_t *bullet, angle_t playerAngle, Vector2 playerFront, float speed);
+// fingerprint of the gameplay state, equal hashes on two runs mean they have not diverged
+uint32_t HashWorld(const world_t *world);
+
+#endif
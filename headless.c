@@ -0,0 +1,504 @@
+// runs the simulation without a window, as fast as the cpu allows
+// usage: ./headless [--ticks n] [--seed n] [--asteroids n] [--threads n] [--record file] [--trace file]
+//        ./headless --replay file [--threads n] [--trace file]
+//        ./headless --rollback n [--delta 0|1] [--ticks n] [--seed n] [--asteroids n] [--threads n] [--trace file]
+//        ./headless --envs n [--ticks n] [--seed n] [--asteroids n] [--threads n]
+//        ./headless --check-handles 1 [--ticks n] [--seed n] [--asteroids n] [--threads n]
+// the first two forms also take [--chunks n] [--field-asteroids n] [--tick-rate n]
+// --asteroids keeps the field topped up to that many, for stress runs
+// --chunks plays on a walled field of n x n chunks filled with --field-asteroids asteroids, only the ones near the
+//   player are stepped. reports how many stayed parked
+// --tick-rate simulates that many ticks per second instead of 60, --ticks still counts ticks
+// --threads 0 uses one thread per core, 1 stays on the calling thread
+// --record writes the scripted session as a replay log
+// --replay re-runs a log and checks every tick against its recorded hash, exits 2 on a mismatch
+// --rollback rewinds n ticks after every tick and re-simulates them from a snapshot ring, exits 2 if the
+//   result differs from the first run. --delta 1 stores the ring as xor deltas
+// --check-handles keeps a pool handle to every asteroid for a second of ticks, checking them after each one, and exits
+//   2 if one resolves to an asteroid other than the one it was taken from. splits and kills free ids that later
+//   spawns take again, those handles have to be turned away
+// --envs steps n batch envs in lockstep with pseudo random actions for --ticks steps and reports env steps per second
+// --trace times every phase of every tick, prints their percentiles and writes chrome trace_event json
+#include "env.h"
+#include "game.h"
+#include "jobs.h"
+#include "kernels.h"
+#include "replay.h"
+#include "snapshot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// scripted pilot: keeps firing while turning, thrusts in bursts
+static unsigned int ScriptedInput(long tick)
+{
+    unsigned int input = inputFire | inputRight;
+    if ((tick / 120) % 2 == 0)
+        input |= inputThrust;
+    return input;
+}
+
+static void PrintRun(long ticks, int threads, double elapsed, int score)
+{
+    printf("ticks:       %ld\n"
+           "threads:     %i\n"
+           "seconds:     %.3f\n"
+           "ticks/s:     %.0f\n"
+           "final score: %i\n",
+           ticks, threads, elapsed, elapsed > 0 ? ticks / elapsed : 0, score);
+}
+
+// percentiles cover the last PROFILE_FRAMES ticks
+static void PrintProfile(const profiler_t *profiler)
+{
+    for (int phase = 0; phase <= phaseCount; phase++)
+    {
+        profile_stats_t stats = GetProfileStats(profiler, phase);
+        printf("%-12s p50 %.3f  p99 %.3f  max %.3f ms\n", profilePhaseNames[phase], stats.p50, stats.p99, stats.max);
+    }
+}
+
+static int RunScripted(world_t *world, long ticks, int asteroids, const char *recordPath, int threads)
+{
+    replay_file_t replay = {0};
+    if (recordPath != NULL && !OpenReplayForWriting(&replay, recordPath, world->config))
+    {
+        fprintf(stderr, "failed to open %s\n", recordPath);
+        return 1;
+    }
+
+    double start = Now();
+    long tick;
+    for (tick = 0; tick < ticks; tick++)
+    {
+        ProfileBeginFrame(world->profiler);
+        while (world->asteroid.pool.count < asteroids && SpawnRandomAsteroid(world))
+            ;
+        unsigned int input = ScriptedInput(tick);
+        StepWorld(world, input);
+        if (replay.file != NULL)
+            WriteReplayTick(&replay, input, HashWorld(world));
+        else if (world->state == gameStateDead)
+            InitGame(world); // a recorded session has to end the way the game does
+        ProfileEndFrame(world->profiler);
+    }
+    double elapsed = Now() - start;
+
+    CloseReplay(&replay);
+    PrintRun(tick, threads, elapsed, world->score);
+    if (world->field.columns > 0)
+        printf("parked:      %i\nactive:      %i\n", world->field.count, world->asteroid.pool.count);
+    return 0;
+}
+
+// one unrecorded tick of the scripted session, deterministic so it can be re-simulated
+static void ScriptedTick(world_t *world, long tick, int asteroids)
+{
+    while (world->asteroid.pool.count < asteroids && SpawnRandomAsteroid(world))
+        ;
+    StepWorld(world, ScriptedInput(tick));
+    if (world->state == gameStateDead)
+        InitGame(world);
+}
+
+// what a rollback netcode client does when a late input arrives every single tick
+static int RunRollback(world_t *world, long ticks, int asteroids, int rollback, bool delta, int threads)
+{
+    snapshot_ring_t ring;
+    if (!InitSnapshotRing(&ring, world, rollback + 1, delta))
+    {
+        fprintf(stderr, "failed to allocate snapshot ring\n");
+        return 1;
+    }
+
+    double worst = 0;
+    double total = 0;
+    long rollbacks = 0;
+    long mismatchTick = -1;
+    size_t ringBytes = 0;
+
+    double start = Now();
+    PushSnapshot(&ring, world);
+    long tick;
+    for (tick = 0; tick < ticks; tick++)
+    {
+        ProfileBeginFrame(world->profiler);
+        ScriptedTick(world, tick, asteroids);
+        PushSnapshot(&ring, world);
+        if (ring.count > rollback)
+        {
+            uint32_t expected = HashWorld(world);
+            double rollbackStart = Now();
+            RestoreSnapshot(&ring, world, rollback);
+            for (long k = tick - rollback + 1; k <= tick; k++)
+            {
+                ScriptedTick(world, k, asteroids);
+                PushSnapshot(&ring, world);
+            }
+            double elapsed = Now() - rollbackStart;
+            worst = elapsed > worst ? elapsed : worst;
+            total += elapsed;
+            rollbacks++;
+            ringBytes = SnapshotRingBytes(&ring);
+            if (HashWorld(world) != expected)
+                mismatchTick = tick;
+        }
+        ProfileEndFrame(world->profiler);
+        if (mismatchTick != -1)
+            break;
+    }
+    double elapsed = Now() - start;
+
+    PrintRun(tick, threads, elapsed, world->score);
+    printf("rollback:    %i ticks, worst %.3f ms, mean %.3f ms\n"
+           "ring:        %zu of %zu bytes\n",
+           rollback, worst * 1e3, rollbacks > 0 ? total / rollbacks * 1e3 : 0,
+           ringBytes, (size_t)ring.capacity * ring.frameBytes);
+    FreeSnapshotRing(&ring);
+    if (mismatchTick != -1)
+    {
+        printf("desync after rolling back at tick %ld\n", mismatchTick);
+        return 2;
+    }
+    printf("rollback verified\n");
+    return 0;
+}
+
+// what an asteroid keeps for its whole life, a handle that still resolves has to find the same values
+typedef struct kept_handle_t
+{
+    handle_t handle;
+    float radius;
+    angle_t angle;
+    float speed;
+} kept_handle_t;
+
+// long enough for splits and kills to free ids and spawns to take them again
+const int handleKeepTicks = 60;
+
+static int RunHandleCheck(world_t *world, long ticks, int asteroids, int threads)
+{
+    const entity_array_t *asteroid = &world->asteroid;
+    kept_handle_t *kept = malloc(asteroid->capacity * sizeof(kept_handle_t));
+    if (kept == NULL)
+    {
+        fprintf(stderr, "failed to allocate handles\n");
+        return 1;
+    }
+
+    long followed = 0; // resolved checks, a handle counts once per tick it is checked
+    long reused = 0;   // stale, and the id belongs to a newer asteroid
+    long freed = 0;    // stale, the id is still free
+    long mismatchTick = -1;
+    int count = 0;
+    double start = Now();
+    long tick;
+    for (tick = 0; tick < ticks && mismatchTick == -1; tick++)
+    {
+        if (tick % handleKeepTicks == 0)
+        {
+            count = asteroid->pool.count;
+            for (int i = 0; i < count; i++)
+                kept[i] = (kept_handle_t){PoolHandle(&asteroid->pool, i), asteroid->radius[i], asteroid->angle[i],
+                                          asteroid->speed[i]};
+        }
+        ScriptedTick(world, tick, asteroids);
+        for (int i = 0; i < count; i++)
+        {
+            int slot = PoolResolve(&asteroid->pool, kept[i].handle);
+            if (slot == -1)
+            {
+                if (asteroid->pool.slotOf[kept[i].handle.id] != -1)
+                    reused++;
+                else
+                    freed++;
+                continue;
+            }
+            if (asteroid->pool.idOf[slot] != kept[i].handle.id || asteroid->radius[slot] != kept[i].radius ||
+                asteroid->angle[slot] != kept[i].angle || asteroid->speed[slot] != kept[i].speed)
+                mismatchTick = tick;
+            followed++;
+        }
+    }
+    double elapsed = Now() - start;
+    free(kept);
+
+    PrintRun(tick, threads, elapsed, world->score);
+    printf("handles:     %ld followed, %ld stale with the id reused, %ld stale with the id free\n",
+           followed, reused, freed);
+    if (mismatchTick != -1)
+    {
+        printf("a handle resolved to another asteroid at tick %ld\n", mismatchTick);
+        return 2;
+    }
+    printf("handles verified\n");
+    return 0;
+}
+
+// the throughput a trainer would see, observations included
+static int RunBatchEnv(int count, long ticks, unsigned int seed, int asteroids, int threads)
+{
+    batch_env_config_t config = DefaultBatchEnvConfig();
+    config.world.seed = seed;
+    config.threads = threads;
+    if (asteroids > 0)
+        config.minAsteroids = asteroids;
+    if (config.minAsteroids * 2 > config.world.maxAsteroids)
+        config.world.maxAsteroids = config.minAsteroids * 2;
+    batch_env_t *env = CreateBatchEnv(count, config);
+    float *observations = malloc((size_t)count * ENV_OBSERVATION_SIZE * sizeof(float));
+    float *rewards = malloc(count * sizeof(float));
+    uint8_t *dones = malloc(count);
+    uint8_t *actions = malloc(count);
+    random_block_t *random = malloc(count * sizeof(random_block_t));
+    if (env == NULL || observations == NULL || rewards == NULL || dones == NULL || actions == NULL || random == NULL)
+    {
+        fprintf(stderr, "failed to allocate %i envs\n", count);
+        return 1;
+    }
+    ResetBatchEnv(env, observations);
+
+    random_key_t key = RandomKey(seed, randomStreamActions);
+    long episodes = 0;
+    double rewardSum = 0;
+    double start = Now();
+    for (long tick = 0; tick < ticks; tick++)
+    {
+        // env i's action at this tick, whatever the env count
+        FillRandomBlocks(key, 0, (uint32_t)tick, 0, random, count);
+        for (int i = 0; i < count; i++)
+            actions[i] = random[i].word[0] & (inputThrust | inputLeft | inputBrake | inputRight | inputFire);
+        StepBatchEnv(env, actions, observations, rewards, dones);
+        for (int i = 0; i < count; i++)
+        {
+            episodes += dones[i];
+            rewardSum += rewards[i];
+        }
+    }
+    double elapsed = Now() - start;
+
+    printf("envs:        %i\n"
+           "threads:     %i\n"
+           "seconds:     %.3f\n"
+           "env steps/s: %.0f\n"
+           "episodes:    %ld\n"
+           "reward/step: %.4f\n",
+           count, env->jobs != NULL ? env->jobs->workerCount + 1 : 1, elapsed,
+           elapsed > 0 ? count * ticks / elapsed : 0, episodes, rewardSum / ((double)count * ticks));
+    free(random);
+    free(actions);
+    free(dones);
+    free(rewards);
+    free(observations);
+    DestroyBatchEnv(env);
+    return 0;
+}
+
+static int RunReplay(world_t *world, replay_file_t *replay, int threads)
+{
+    unsigned int input;
+    uint32_t expected;
+    long mismatchTick = -1;
+
+    double start = Now();
+    long tick = 0;
+    while (ReadReplayTick(replay, &input, &expected))
+    {
+        ProfileBeginFrame(world->profiler);
+        StepWorld(world, input);
+        ProfileEndFrame(world->profiler);
+        if (HashWorld(world) != expected)
+        {
+            mismatchTick = tick;
+            break;
+        }
+        tick++;
+    }
+    double elapsed = Now() - start;
+
+    PrintRun(tick, threads, elapsed, world->score);
+    if (mismatchTick != -1)
+    {
+        printf("desync at tick %ld\n", mismatchTick);
+        return 2;
+    }
+    printf("replay verified\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    long ticks = 100000;
+    world_config_t config = DefaultWorldConfig();
+    int asteroids = 0;
+    int threads = 1;
+    const char *recordPath = NULL;
+    const char *replayPath = NULL;
+    const char *tracePath = NULL;
+    int rollback = 0;
+    bool delta = false;
+    bool checkHandles = false;
+    int envs = 0;
+    int chunks = 0;
+    int fieldAsteroids = 0;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--ticks") == 0)
+            ticks = atol(argv[i + 1]);
+        else if (strcmp(argv[i], "--seed") == 0)
+            config.seed = (unsigned int)atol(argv[i + 1]);
+        else if (strcmp(argv[i], "--asteroids") == 0)
+            asteroids = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--threads") == 0)
+            threads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--record") == 0)
+            recordPath = argv[i + 1];
+        else if (strcmp(argv[i], "--replay") == 0)
+            replayPath = argv[i + 1];
+        else if (strcmp(argv[i], "--trace") == 0)
+            tracePath = argv[i + 1];
+        else if (strcmp(argv[i], "--rollback") == 0)
+            rollback = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--delta") == 0)
+            delta = atoi(argv[i + 1]) != 0;
+        else if (strcmp(argv[i], "--check-handles") == 0)
+            checkHandles = atoi(argv[i + 1]) != 0;
+        else if (strcmp(argv[i], "--envs") == 0)
+            envs = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--chunks") == 0)
+            chunks = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--field-asteroids") == 0)
+            fieldAsteroids = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--tick-rate") == 0)
+            config.tickRate = atoi(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (recordPath != NULL && asteroids > 0)
+    {
+        fprintf(stderr, "--asteroids spawns outside the simulation and cannot be recorded\n");
+        return 1;
+    }
+
+    if (chunks > 0 && asteroids > 0)
+    {
+        fprintf(stderr, "--asteroids spawns around the screen's edges and cannot be used with --chunks\n");
+        return 1;
+    }
+    bool customTicks = config.tickRate != defaultTickRate;
+    if ((chunks > 0 || customTicks) && (envs > 0 || replayPath != NULL))
+    {
+        fprintf(stderr, "--chunks and --tick-rate set up a new session and cannot be combined with --envs or --replay\n");
+        return 1;
+    }
+    if (config.tickRate < minTickRate)
+    {
+        fprintf(stderr, "--tick-rate must be at least %i\n", minTickRate);
+        return 1;
+    }
+
+    if (rollback > 0 && (recordPath != NULL || replayPath != NULL))
+    {
+        fprintf(stderr, "--rollback runs the scripted session and cannot be combined with --record or --replay\n");
+        return 1;
+    }
+    if (checkHandles && (recordPath != NULL || replayPath != NULL || rollback > 0))
+    {
+        fprintf(stderr, "--check-handles runs the scripted session and cannot be combined with --record, --replay or "
+                        "--rollback\n");
+        return 1;
+    }
+
+    if (envs > 0)
+    {
+        if (recordPath != NULL || replayPath != NULL || rollback > 0 || checkHandles || tracePath != NULL)
+        {
+            fprintf(stderr, "--envs runs on its own and cannot be combined with --record, --replay, --rollback, "
+                            "--check-handles or --trace\n");
+            return 1;
+        }
+        return RunBatchEnv(envs, ticks, config.seed, asteroids, threads);
+    }
+
+    replay_file_t replay = {0};
+    if (replayPath != NULL)
+    {
+        if (!OpenReplayForReading(&replay, replayPath))
+        {
+            fprintf(stderr, "failed to read %s\n", replayPath);
+            return 1;
+        }
+        config = replay.header.config;
+    }
+    else if (asteroids * 2 > config.maxAsteroids)
+    {
+        config.maxAsteroids = asteroids * 2; // room for splits
+    }
+    if (chunks > 0)
+        config = ChunkedWorldConfig(config, chunks, fieldAsteroids);
+
+    world_t *world = CreateWorld(config);
+    if (world == NULL)
+    {
+        fprintf(stderr, "failed to allocate world\n");
+        return 1;
+    }
+
+    job_system_t jobs;
+    bool useJobs = threads != 1;
+    if (useJobs && !InitJobSystem(&jobs, threads > 1 ? threads - 1 : 0))
+    {
+        fprintf(stderr, "failed to start job system\n");
+        return 1;
+    }
+    if (useJobs)
+        world->jobs = &jobs;
+    int threadCount = useJobs ? jobs.workerCount + 1 : 1;
+
+    profiler_t profiler = {0};
+    if (tracePath != NULL)
+    {
+        if (!InitProfiler(&profiler, true))
+        {
+            fprintf(stderr, "failed to allocate profiler\n");
+            return 1;
+        }
+        world->profiler = &profiler;
+    }
+
+    int result;
+    if (replayPath != NULL)
+        result = RunReplay(world, &replay, threadCount);
+    else if (rollback > 0)
+        result = RunRollback(world, ticks, asteroids, rollback, delta, threadCount);
+    else if (checkHandles)
+        result = RunHandleCheck(world, ticks, asteroids, threadCount);
+    else
+        result = RunScripted(world, ticks, asteroids, recordPath, threadCount);
+
+    if (tracePath != NULL)
+    {
+        PrintProfile(&profiler);
+        if (!WriteChromeTrace(&profiler, tracePath))
+            fprintf(stderr, "failed to write %s\n", tracePath);
+    }
+
+    CloseReplay(&replay);
+    FreeProfiler(&profiler);
+    if (useJobs)
+        ShutdownJobSystem(&jobs);
+    DestroyWorld(world);
+    return result;
+}
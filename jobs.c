@@ -0,0 +1,208 @@
+#include "jobs.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct worker_start_t
+{
+    job_system_t *jobs;
+    int index;
+} worker_start_t;
+
+static uint64_t PackRange(int begin, int end)
+{
+    return ((uint64_t)(uint32_t)begin << 32) | (uint32_t)end;
+}
+
+static void UnpackRange(uint64_t range, int *begin, int *end)
+{
+    *begin = (int)(uint32_t)(range >> 32);
+    *end = (int)(uint32_t)range;
+}
+
+static bool PushRange(job_deque_t *deque, uint64_t range)
+{
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= JOB_DEQUE_SIZE)
+        return false;
+    atomic_store_explicit(&deque->range[bottom & (JOB_DEQUE_SIZE - 1)], range, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return true;
+}
+
+static bool PopRange(job_deque_t *deque, uint64_t *range)
+{
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    if (top > bottom)
+    {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return false;
+    }
+    *range = atomic_load_explicit(&deque->range[bottom & (JOB_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (top == bottom)
+    {
+        // last entry, race any thief for it
+        bool won = atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                           memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+static bool StealRange(job_deque_t *deque, uint64_t *range)
+{
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom)
+        return false;
+    *range = atomic_load_explicit(&deque->range[top & (JOB_DEQUE_SIZE - 1)], memory_order_relaxed);
+    return atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                   memory_order_seq_cst, memory_order_relaxed);
+}
+
+// runs a range, splitting off the upper half onto our own deque while it is bigger than
+// the grain so idle workers have something to steal
+static void RunRange(job_system_t *jobs, int worker, uint64_t range)
+{
+    int begin, end;
+    UnpackRange(range, &begin, &end);
+    while (end - begin > jobs->grain)
+    {
+        int middle = begin + (end - begin) / 2;
+        if (!PushRange(&jobs->deques[worker], PackRange(middle, end)))
+            break;
+        end = middle;
+    }
+    jobs->function(jobs->context, begin, end, worker);
+    atomic_fetch_sub_explicit(&jobs->pending, end - begin, memory_order_acq_rel);
+}
+
+static bool FindWork(job_system_t *jobs, int worker, uint64_t *range)
+{
+    if (PopRange(&jobs->deques[worker], range))
+        return true;
+    int deques = jobs->workerCount + 1;
+    for (int n = 1; n < deques; n++)
+    {
+        if (StealRange(&jobs->deques[(worker + n) % deques], range))
+            return true;
+    }
+    return false;
+}
+
+static void HelpUntilDone(job_system_t *jobs, int worker)
+{
+    uint64_t range;
+    while (atomic_load_explicit(&jobs->pending, memory_order_acquire) > 0)
+    {
+        if (FindWork(jobs, worker, &range))
+            RunRange(jobs, worker, range);
+    }
+}
+
+static void *WorkerMain(void *argument)
+{
+    worker_start_t start = *(worker_start_t *)argument;
+    free(argument);
+    job_system_t *jobs = start.jobs;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&jobs->lock);
+    while (true)
+    {
+        while (jobs->running && jobs->generation == seen)
+            pthread_cond_wait(&jobs->wake, &jobs->lock);
+        if (!jobs->running)
+            break;
+        seen = jobs->generation;
+        pthread_mutex_unlock(&jobs->lock);
+
+        HelpUntilDone(jobs, start.index);
+
+        pthread_mutex_lock(&jobs->lock);
+    }
+    pthread_mutex_unlock(&jobs->lock);
+    return NULL;
+}
+
+bool InitJobSystem(job_system_t *jobs, int workerCount)
+{
+    if (workerCount <= 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workerCount = cores > 1 ? (int)cores - 1 : 0;
+    }
+    *jobs = (job_system_t){.running = true};
+    jobs->deques = calloc(workerCount + 1, sizeof(job_deque_t));
+    jobs->threads = calloc(workerCount > 0 ? workerCount : 1, sizeof(pthread_t));
+    if (jobs->deques == NULL || jobs->threads == NULL)
+    {
+        free(jobs->deques);
+        free(jobs->threads);
+        return false;
+    }
+    pthread_mutex_init(&jobs->lock, NULL);
+    pthread_cond_init(&jobs->wake, NULL);
+
+    for (int i = 0; i < workerCount; i++)
+    {
+        worker_start_t *start = malloc(sizeof(worker_start_t));
+        if (start == NULL)
+            break;
+        *start = (worker_start_t){.jobs = jobs, .index = i + 1};
+        if (pthread_create(&jobs->threads[i], NULL, WorkerMain, start) != 0)
+        {
+            free(start);
+            break;
+        }
+        jobs->workerCount++;
+    }
+    return true;
+}
+
+void ShutdownJobSystem(job_system_t *jobs)
+{
+    pthread_mutex_lock(&jobs->lock);
+    jobs->running = false;
+    pthread_cond_broadcast(&jobs->wake);
+    pthread_mutex_unlock(&jobs->lock);
+    for (int i = 0; i < jobs->workerCount; i++)
+        pthread_join(jobs->threads[i], NULL);
+    pthread_cond_destroy(&jobs->wake);
+    pthread_mutex_destroy(&jobs->lock);
+    free(jobs->threads);
+    free(jobs->deques);
+    *jobs = (job_system_t){0};
+}
+
+void ParallelFor(job_system_t *jobs, int count, int grain, job_function_t function, void *context)
+{
+    if (count <= 0)
+        return;
+    if (grain < 1)
+        grain = 1;
+    if (jobs == NULL || jobs->workerCount == 0 || count <= grain)
+    {
+        function(context, 0, count, 0);
+        return;
+    }
+
+    jobs->function = function;
+    jobs->context = context;
+    jobs->grain = grain;
+    atomic_store_explicit(&jobs->pending, count, memory_order_release);
+    PushRange(&jobs->deques[0], PackRange(0, count));
+
+    pthread_mutex_lock(&jobs->lock);
+    jobs->generation++;
+    pthread_cond_broadcast(&jobs->wake);
+    pthread_mutex_unlock(&jobs->lock);
+
+    HelpUntilDone(jobs, 0);
+}
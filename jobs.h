@@ -0,0 +1,50 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define JOB_DEQUE_SIZE 1024 // power of two, a full deque just runs the job inline
+
+// runs items begin..end-1. worker is 0 for the calling thread and 1..workerCount for the pool
+typedef void (*job_function_t)(void *context, int begin, int end, int worker);
+
+// chase-lev deque of packed begin/end ranges. the owner pushes and pops at the bottom,
+// any other thread may steal from the top
+typedef struct job_deque_t
+{
+    _Atomic int64_t top;
+    _Atomic int64_t bottom;
+    _Atomic uint64_t range[JOB_DEQUE_SIZE];
+} job_deque_t;
+
+typedef struct job_system_t
+{
+    int workerCount; // threads besides the caller
+    pthread_t *threads;
+    job_deque_t *deques; // workerCount + 1, index 0 belongs to the caller
+
+    // the parallel for currently running
+    job_function_t function;
+    void *context;
+    int grain;
+    _Atomic int pending; // items not finished yet
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    unsigned long generation; // bumped for every parallel for, guarded by lock
+    bool running;
+} job_system_t;
+
+// workerCount 0 starts one worker per extra core. a system with no workers is valid and
+// runs everything on the caller, which is how the single-threaded path stays identical
+bool InitJobSystem(job_system_t *jobs, int workerCount);
+void ShutdownJobSystem(job_system_t *jobs);
+
+// calls function over 0..count-1 split into ranges of at least grain items and waits for all of them.
+// jobs may be NULL. only one thread may issue parallel fors on a system at a time
+void ParallelFor(job_system_t *jobs, int count, int grain, job_function_t function, void *context);
+
+#endif
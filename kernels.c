@@ -0,0 +1,398 @@
+#include "kernels.h"
+#include "entity.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// same operations in the same order as the vector versions, so every build agrees
+static inline int ScalarSweptOverlap(float cx, float cy, float cdx, float cdy, float cr,
+                                     float x, float y, float dx, float dy, float radius)
+{
+    float ex = cx - x;
+    float ey = cy - y;
+    float wx = cdx - dx;
+    float wy = cdy - dy;
+    float sx = ex - wx;
+    float sy = ey - wy;
+    float r = cr + radius;
+    float rr = r * r;
+    float end = ex * ex + ey * ey;
+    float start = sx * sx + sy * sy;
+    float dot = sx * wx + sy * wy;
+    float ww = wx * wx + wy * wy;
+    int between = dot < 0 && -dot < ww && start * ww - dot * dot <= rr * ww;
+    return end <= rr || start <= rr || between;
+}
+
+#if defined(__AVX__)
+
+const char *KernelsInstructionSet(void) { return "avx"; }
+
+void CullEntities(const float *x, const float *y, const float *radius, int32_t *alive, int count,
+                  float minX, float minY, float maxX, float maxY, float margin)
+{
+    __m256 m = _mm256_set1_ps(margin);
+    __m256 x0 = _mm256_set1_ps(minX);
+    __m256 y0 = _mm256_set1_ps(minY);
+    __m256 x1 = _mm256_set1_ps(maxX);
+    __m256 y1 = _mm256_set1_ps(maxY);
+    for (int i = 0; i < count; i += 8)
+    {
+        __m256 r = _mm256_add_ps(_mm256_load_ps(&radius[i]), m);
+        __m256 px = _mm256_load_ps(&x[i]);
+        __m256 py = _mm256_load_ps(&y[i]);
+        __m256 inside = _mm256_and_ps(_mm256_cmp_ps(px, _mm256_sub_ps(x0, r), _CMP_GE_OQ),
+                                      _mm256_cmp_ps(px, _mm256_add_ps(x1, r), _CMP_LE_OQ));
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(py, _mm256_sub_ps(y0, r), _CMP_GE_OQ));
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(py, _mm256_add_ps(y1, r), _CMP_LE_OQ));
+        __m256 a = _mm256_load_ps((const float *)&alive[i]);
+        _mm256_store_ps((float *)&alive[i], _mm256_and_ps(a, inside));
+    }
+}
+
+void IntegrateEntities(float *x, float *y, float *previousX, float *previousY, const float *vx, const float *vy,
+                       const int32_t *alive, int count)
+{
+    for (int i = 0; i < count; i += 8)
+    {
+        __m256 a = _mm256_load_ps((const float *)&alive[i]);
+        __m256 px = _mm256_load_ps(&x[i]);
+        __m256 py = _mm256_load_ps(&y[i]);
+        _mm256_store_ps(&previousX[i], px);
+        _mm256_store_ps(&previousY[i], py);
+        _mm256_store_ps(&x[i], _mm256_add_ps(px, _mm256_and_ps(_mm256_load_ps(&vx[i]), a)));
+        _mm256_store_ps(&y[i], _mm256_add_ps(py, _mm256_and_ps(_mm256_load_ps(&vy[i]), a)));
+    }
+}
+
+void AgeParticles(float *x, float *y, float *vx, float *vy, float *life, float dt, float damp, int count)
+{
+    __m256 t = _mm256_set1_ps(dt);
+    __m256 d = _mm256_set1_ps(damp);
+    for (int i = 0; i < count; i += 8)
+    {
+        __m256 px = _mm256_load_ps(&vx[i]);
+        __m256 py = _mm256_load_ps(&vy[i]);
+        _mm256_store_ps(&x[i], _mm256_add_ps(_mm256_load_ps(&x[i]), _mm256_mul_ps(px, t)));
+        _mm256_store_ps(&y[i], _mm256_add_ps(_mm256_load_ps(&y[i]), _mm256_mul_ps(py, t)));
+        _mm256_store_ps(&vx[i], _mm256_mul_ps(px, d));
+        _mm256_store_ps(&vy[i], _mm256_mul_ps(py, d));
+        _mm256_store_ps(&life[i], _mm256_sub_ps(_mm256_load_ps(&life[i]), t));
+    }
+}
+
+int FirstSweptOverlap(float cx, float cy, float cdx, float cdy, float cr,
+                      const float *x, const float *y, const float *dx, const float *dy, const float *radius,
+                      int start, int count)
+{
+    __m256 px = _mm256_set1_ps(cx);
+    __m256 py = _mm256_set1_ps(cy);
+    __m256 pdx = _mm256_set1_ps(cdx);
+    __m256 pdy = _mm256_set1_ps(cdy);
+    __m256 pr = _mm256_set1_ps(cr);
+    __m256 zero = _mm256_setzero_ps();
+    int i = start;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 ex = _mm256_sub_ps(px, _mm256_loadu_ps(&x[i]));
+        __m256 ey = _mm256_sub_ps(py, _mm256_loadu_ps(&y[i]));
+        __m256 wx = _mm256_sub_ps(pdx, _mm256_loadu_ps(&dx[i]));
+        __m256 wy = _mm256_sub_ps(pdy, _mm256_loadu_ps(&dy[i]));
+        __m256 sx = _mm256_sub_ps(ex, wx);
+        __m256 sy = _mm256_sub_ps(ey, wy);
+        __m256 r = _mm256_add_ps(pr, _mm256_loadu_ps(&radius[i]));
+        __m256 rr = _mm256_mul_ps(r, r);
+        __m256 end = _mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey));
+        __m256 begin = _mm256_add_ps(_mm256_mul_ps(sx, sx), _mm256_mul_ps(sy, sy));
+        __m256 dot = _mm256_add_ps(_mm256_mul_ps(sx, wx), _mm256_mul_ps(sy, wy));
+        __m256 ww = _mm256_add_ps(_mm256_mul_ps(wx, wx), _mm256_mul_ps(wy, wy));
+        __m256 closest = _mm256_sub_ps(_mm256_mul_ps(begin, ww), _mm256_mul_ps(dot, dot));
+        // closest approach falls inside the tick, checked without dividing by ww
+        __m256 between = _mm256_and_ps(_mm256_cmp_ps(dot, zero, _CMP_LT_OQ), _mm256_cmp_ps(_mm256_sub_ps(zero, dot), ww, _CMP_LT_OQ));
+        between = _mm256_and_ps(between, _mm256_cmp_ps(closest, _mm256_mul_ps(rr, ww), _CMP_LE_OQ));
+        __m256 hit = _mm256_or_ps(_mm256_cmp_ps(end, rr, _CMP_LE_OQ), _mm256_cmp_ps(begin, rr, _CMP_LE_OQ));
+        int hits = _mm256_movemask_ps(_mm256_or_ps(hit, between));
+        if (hits)
+            return i + __builtin_ctz(hits);
+    }
+    for (; i < count; i++)
+        if (ScalarSweptOverlap(cx, cy, cdx, cdy, cr, x[i], y[i], dx[i], dy[i], radius[i]))
+            return i;
+    return -1;
+}
+
+#elif defined(__SSE2__)
+
+const char *KernelsInstructionSet(void) { return "sse2"; }
+
+void CullEntities(const float *x, const float *y, const float *radius, int32_t *alive, int count,
+                  float minX, float minY, float maxX, float maxY, float margin)
+{
+    __m128 m = _mm_set1_ps(margin);
+    __m128 x0 = _mm_set1_ps(minX);
+    __m128 y0 = _mm_set1_ps(minY);
+    __m128 x1 = _mm_set1_ps(maxX);
+    __m128 y1 = _mm_set1_ps(maxY);
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128 r = _mm_add_ps(_mm_load_ps(&radius[i]), m);
+        __m128 px = _mm_load_ps(&x[i]);
+        __m128 py = _mm_load_ps(&y[i]);
+        __m128 inside = _mm_and_ps(_mm_cmpge_ps(px, _mm_sub_ps(x0, r)), _mm_cmple_ps(px, _mm_add_ps(x1, r)));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(py, _mm_sub_ps(y0, r)));
+        inside = _mm_and_ps(inside, _mm_cmple_ps(py, _mm_add_ps(y1, r)));
+        __m128 a = _mm_load_ps((const float *)&alive[i]);
+        _mm_store_ps((float *)&alive[i], _mm_and_ps(a, inside));
+    }
+}
+
+void IntegrateEntities(float *x, float *y, float *previousX, float *previousY, const float *vx, const float *vy,
+                       const int32_t *alive, int count)
+{
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128 a = _mm_load_ps((const float *)&alive[i]);
+        __m128 px = _mm_load_ps(&x[i]);
+        __m128 py = _mm_load_ps(&y[i]);
+        _mm_store_ps(&previousX[i], px);
+        _mm_store_ps(&previousY[i], py);
+        _mm_store_ps(&x[i], _mm_add_ps(px, _mm_and_ps(_mm_load_ps(&vx[i]), a)));
+        _mm_store_ps(&y[i], _mm_add_ps(py, _mm_and_ps(_mm_load_ps(&vy[i]), a)));
+    }
+}
+
+void AgeParticles(float *x, float *y, float *vx, float *vy, float *life, float dt, float damp, int count)
+{
+    __m128 t = _mm_set1_ps(dt);
+    __m128 d = _mm_set1_ps(damp);
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128 px = _mm_load_ps(&vx[i]);
+        __m128 py = _mm_load_ps(&vy[i]);
+        _mm_store_ps(&x[i], _mm_add_ps(_mm_load_ps(&x[i]), _mm_mul_ps(px, t)));
+        _mm_store_ps(&y[i], _mm_add_ps(_mm_load_ps(&y[i]), _mm_mul_ps(py, t)));
+        _mm_store_ps(&vx[i], _mm_mul_ps(px, d));
+        _mm_store_ps(&vy[i], _mm_mul_ps(py, d));
+        _mm_store_ps(&life[i], _mm_sub_ps(_mm_load_ps(&life[i]), t));
+    }
+}
+
+int FirstSweptOverlap(float cx, float cy, float cdx, float cdy, float cr,
+                      const float *x, const float *y, const float *dx, const float *dy, const float *radius,
+                      int start, int count)
+{
+    __m128 px = _mm_set1_ps(cx);
+    __m128 py = _mm_set1_ps(cy);
+    __m128 pdx = _mm_set1_ps(cdx);
+    __m128 pdy = _mm_set1_ps(cdy);
+    __m128 pr = _mm_set1_ps(cr);
+    __m128 zero = _mm_setzero_ps();
+    int i = start;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 ex = _mm_sub_ps(px, _mm_loadu_ps(&x[i]));
+        __m128 ey = _mm_sub_ps(py, _mm_loadu_ps(&y[i]));
+        __m128 wx = _mm_sub_ps(pdx, _mm_loadu_ps(&dx[i]));
+        __m128 wy = _mm_sub_ps(pdy, _mm_loadu_ps(&dy[i]));
+        __m128 sx = _mm_sub_ps(ex, wx);
+        __m128 sy = _mm_sub_ps(ey, wy);
+        __m128 r = _mm_add_ps(pr, _mm_loadu_ps(&radius[i]));
+        __m128 rr = _mm_mul_ps(r, r);
+        __m128 end = _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey));
+        __m128 begin = _mm_add_ps(_mm_mul_ps(sx, sx), _mm_mul_ps(sy, sy));
+        __m128 dot = _mm_add_ps(_mm_mul_ps(sx, wx), _mm_mul_ps(sy, wy));
+        __m128 ww = _mm_add_ps(_mm_mul_ps(wx, wx), _mm_mul_ps(wy, wy));
+        __m128 closest = _mm_sub_ps(_mm_mul_ps(begin, ww), _mm_mul_ps(dot, dot));
+        // closest approach falls inside the tick, checked without dividing by ww
+        __m128 between = _mm_and_ps(_mm_cmplt_ps(dot, zero), _mm_cmplt_ps(_mm_sub_ps(zero, dot), ww));
+        between = _mm_and_ps(between, _mm_cmple_ps(closest, _mm_mul_ps(rr, ww)));
+        __m128 hit = _mm_or_ps(_mm_cmple_ps(end, rr), _mm_cmple_ps(begin, rr));
+        int hits = _mm_movemask_ps(_mm_or_ps(hit, between));
+        if (hits)
+            return i + __builtin_ctz(hits);
+    }
+    for (; i < count; i++)
+        if (ScalarSweptOverlap(cx, cy, cdx, cdy, cr, x[i], y[i], dx[i], dy[i], radius[i]))
+            return i;
+    return -1;
+}
+
+#else
+
+const char *KernelsInstructionSet(void) { return "scalar"; }
+
+void CullEntities(const float *x, const float *y, const float *radius, int32_t *alive, int count,
+                  float minX, float minY, float maxX, float maxY, float margin)
+{
+    for (int i = 0; i < count; i++)
+    {
+        float r = radius[i] + margin;
+        int inside = x[i] >= minX - r && x[i] <= maxX + r && y[i] >= minY - r && y[i] <= maxY + r;
+        alive[i] &= -inside;
+    }
+}
+
+void IntegrateEntities(float *x, float *y, float *previousX, float *previousY, const float *vx, const float *vy,
+                       const int32_t *alive, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        previousX[i] = x[i];
+        previousY[i] = y[i];
+        if (alive[i])
+        {
+            x[i] += vx[i];
+            y[i] += vy[i];
+        }
+    }
+}
+
+void AgeParticles(float *x, float *y, float *vx, float *vy, float *life, float dt, float damp, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+        vx[i] *= damp;
+        vy[i] *= damp;
+        life[i] -= dt;
+    }
+}
+
+int FirstSweptOverlap(float cx, float cy, float cdx, float cdy, float cr,
+                      const float *x, const float *y, const float *dx, const float *dy, const float *radius,
+                      int start, int count)
+{
+    for (int i = start; i < count; i++)
+        if (ScalarSweptOverlap(cx, cy, cdx, cdy, cr, x[i], y[i], dx[i], dy[i], radius[i]))
+            return i;
+    return -1;
+}
+
+#endif
+
+// philox on a whole vector of counters. only the first counter word differs between lanes, and the multiplies
+// are 32 x 32 -> 64 on the even lanes, so the odd lanes are shifted down and multiplied separately
+#if defined(__AVX2__)
+
+static inline void MulHiLo(__m256i a, __m256i m, __m256i *hi, __m256i *lo)
+{
+    __m256i even = _mm256_mul_epu32(a, m);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+    *lo = _mm256_unpacklo_epi32(_mm256_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 2, 0)),
+                                _mm256_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 2, 0)));
+    *hi = _mm256_unpacklo_epi32(_mm256_shuffle_epi32(even, _MM_SHUFFLE(2, 0, 3, 1)),
+                                _mm256_shuffle_epi32(odd, _MM_SHUFFLE(2, 0, 3, 1)));
+}
+
+void FillRandomBlocks(random_key_t key, uint32_t firstId, uint32_t tick, uint32_t draw, random_block_t *blocks,
+                      int count)
+{
+    __m256i m0 = _mm256_set1_epi32((int)PHILOX_M0);
+    __m256i m1 = _mm256_set1_epi32((int)PHILOX_M1);
+    __m256i step = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32((int)(firstId + i)), step);
+        __m256i c1 = _mm256_set1_epi32((int)tick);
+        __m256i c2 = _mm256_set1_epi32((int)draw);
+        __m256i c3 = _mm256_setzero_si256();
+        uint32_t k0 = key.seed, k1 = key.stream;
+        for (int round = 0; round < PHILOX_ROUNDS; round++)
+        {
+            __m256i hi0, lo0, hi1, lo1;
+            MulHiLo(c0, m0, &hi0, &lo0);
+            MulHiLo(c2, m1, &hi1, &lo1);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32((int)k0));
+            c1 = lo1;
+            c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32((int)k1));
+            c3 = lo0;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        // lanes back into blocks, counters 0-3 in the low halves and 4-7 in the high ones
+        __m256i t0 = _mm256_unpacklo_epi32(c0, c1);
+        __m256i t1 = _mm256_unpacklo_epi32(c2, c3);
+        __m256i t2 = _mm256_unpackhi_epi32(c0, c1);
+        __m256i t3 = _mm256_unpackhi_epi32(c2, c3);
+        __m256i r0 = _mm256_unpacklo_epi64(t0, t1);
+        __m256i r1 = _mm256_unpackhi_epi64(t0, t1);
+        __m256i r2 = _mm256_unpacklo_epi64(t2, t3);
+        __m256i r3 = _mm256_unpackhi_epi64(t2, t3);
+        __m256i *out = (__m256i *)&blocks[i];
+        _mm256_storeu_si256(out, _mm256_permute2x128_si256(r0, r1, 0x20));
+        _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(r2, r3, 0x20));
+        _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(r0, r1, 0x31));
+        _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(r2, r3, 0x31));
+    }
+    for (; i < count; i++)
+        blocks[i] = RandomBlock(key, firstId + i, tick, draw);
+}
+
+#elif defined(__SSE2__)
+
+static inline void MulHiLo(__m128i a, __m128i m, __m128i *hi, __m128i *lo)
+{
+    __m128i even = _mm_mul_epu32(a, m);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), m);
+    *lo = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 2, 0)),
+                             _mm_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 2, 0)));
+    *hi = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(2, 0, 3, 1)),
+                             _mm_shuffle_epi32(odd, _MM_SHUFFLE(2, 0, 3, 1)));
+}
+
+void FillRandomBlocks(random_key_t key, uint32_t firstId, uint32_t tick, uint32_t draw, random_block_t *blocks,
+                      int count)
+{
+    __m128i m0 = _mm_set1_epi32((int)PHILOX_M0);
+    __m128i m1 = _mm_set1_epi32((int)PHILOX_M1);
+    __m128i step = _mm_setr_epi32(0, 1, 2, 3);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i c0 = _mm_add_epi32(_mm_set1_epi32((int)(firstId + i)), step);
+        __m128i c1 = _mm_set1_epi32((int)tick);
+        __m128i c2 = _mm_set1_epi32((int)draw);
+        __m128i c3 = _mm_setzero_si128();
+        uint32_t k0 = key.seed, k1 = key.stream;
+        for (int round = 0; round < PHILOX_ROUNDS; round++)
+        {
+            __m128i hi0, lo0, hi1, lo1;
+            MulHiLo(c0, m0, &hi0, &lo0);
+            MulHiLo(c2, m1, &hi1, &lo1);
+            c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32((int)k0));
+            c1 = lo1;
+            c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32((int)k1));
+            c3 = lo0;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        // lanes back into blocks, a 4 x 4 transpose
+        __m128i t0 = _mm_unpacklo_epi32(c0, c1);
+        __m128i t1 = _mm_unpacklo_epi32(c2, c3);
+        __m128i t2 = _mm_unpackhi_epi32(c0, c1);
+        __m128i t3 = _mm_unpackhi_epi32(c2, c3);
+        __m128i *out = (__m128i *)&blocks[i];
+        _mm_storeu_si128(out, _mm_unpacklo_epi64(t0, t1));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi64(t0, t1));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi64(t2, t3));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi64(t2, t3));
+    }
+    for (; i < count; i++)
+        blocks[i] = RandomBlock(key, firstId + i, tick, draw);
+}
+
+#else
+
+void FillRandomBlocks(random_key_t key, uint32_t firstId, uint32_t tick, uint32_t draw, random_block_t *blocks,
+                      int count)
+{
+    for (int i = 0; i < count; i++)
+        blocks[i] = RandomBlock(key, firstId + i, tick, draw);
+}
+
+#endif
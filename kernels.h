@@ -0,0 +1,38 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "rng.h"
+#include <stdint.h>
+
+// vectorized loops over entity_array_t and particle lanes. built with avx when the compiler targets it,
+// sse2 otherwise, and plain c on anything else. all three give the same results.
+
+// clears alive for every entity whose center left the rect minX..maxX, minY..maxY grown by its radius + margin.
+// count must be a multiple of ENTITY_LANES
+void CullEntities(const float *x, const float *y, const float *radius, int32_t *alive, int count,
+                  float minX, float minY, float maxX, float maxY, float margin);
+
+// copies position to previous, then adds velocity to position for every alive entity.
+// count must be a multiple of ENTITY_LANES
+void IntegrateEntities(float *x, float *y, float *previousX, float *previousY, const float *vx, const float *vy,
+                       const int32_t *alive, int count);
+
+// moves particles by velocity * dt, scales velocity by damp and takes dt off life.
+// count must be a multiple of ENTITY_LANES
+void AgeParticles(float *x, float *y, float *vx, float *vy, float *life, float dt, float damp, int count);
+
+// first index in start..count-1 whose circle touches circle (cx, cy, cr) at any point during the last tick, or -1.
+// both are given at their end positions and moved in straight lines by (cdx, cdy) and (dx, dy). any count is fine
+int FirstSweptOverlap(float cx, float cy, float cdx, float cdy, float cr,
+                      const float *x, const float *y, const float *dx, const float *dy, const float *radius,
+                      int start, int count);
+
+// blocks[i] = RandomBlock(key, firstId + i, tick, draw), several counters at once. this one uses avx2 rather than
+// avx, which has no 256 bit integer multiply. any count is fine
+void FillRandomBlocks(random_key_t key, uint32_t firstId, uint32_t tick, uint32_t draw, random_block_t *blocks,
+                      int count);
+
+// name of the instruction set the kernels were built for
+const char *KernelsInstructionSet(void);
+
+#endif
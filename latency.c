@@ -0,0 +1,59 @@
+#include "latency.h"
+#include <stdlib.h>
+
+void RecordFrameTimes(latency_tracker_t *tracker, frame_times_t times)
+{
+    tracker->frame[tracker->next] = times;
+    tracker->next = (tracker->next + 1) % LATENCY_FRAMES;
+    if (tracker->count < LATENCY_FRAMES)
+        tracker->count++;
+}
+
+static int CompareLatencies(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+latency_stats_t GetLatencyStats(const latency_tracker_t *tracker)
+{
+    latency_stats_t stats = {0};
+    int count = tracker->count;
+    if (count == 0)
+        return stats;
+    double sorted[LATENCY_FRAMES];
+    double ship[LATENCY_FRAMES];
+    for (int i = 0; i < count; i++)
+    {
+        frame_times_t times = tracker->frame[i];
+        double latency = (times.swap - times.inputPoll) * 1000;
+        ship[i] = (times.swap - times.shipPoll) * 1000;
+        int bucket = (int)latency;
+        stats.histogram[bucket < 0 ? 0 : bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+        stats.startToSim += (times.simDone - times.start) * 1000 / count;
+        stats.simToSubmit += (times.drawSubmit - times.simDone) * 1000 / count;
+        stats.submitToSwap += (times.swap - times.drawSubmit) * 1000 / count;
+        sorted[i] = latency;
+    }
+    qsort(sorted, count, sizeof(double), CompareLatencies);
+    stats.p50 = sorted[count / 2];
+    stats.p99 = sorted[(count * 99) / 100];
+    stats.max = sorted[count - 1];
+    qsort(ship, count, sizeof(double), CompareLatencies);
+    stats.shipP50 = ship[count / 2];
+    stats.shipP99 = ship[(count * 99) / 100];
+    return stats;
+}
+
+double FrameWorkEstimate(const latency_tracker_t *tracker, int frames)
+{
+    double longest = 0;
+    for (int i = 0; i < frames && i < tracker->count; i++)
+    {
+        frame_times_t times = tracker->frame[(tracker->next - 1 - i + LATENCY_FRAMES) % LATENCY_FRAMES];
+        if (times.swap - times.start > longest)
+            longest = times.swap - times.start;
+    }
+    return longest;
+}
@@ -0,0 +1,45 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#define LATENCY_FRAMES 240 // frames of timestamps kept
+#define LATENCY_BUCKETS 40 // 1 ms wide, the last one also holds everything slower
+
+// when the parts of one frame happened, in GetTime seconds
+typedef struct frame_times_t
+{
+    double start;      // work on the frame began, after any wait before it
+    double inputPoll;  // the input this frame's ticks stepped with, fire, turn and thrust, was read from the os
+    double shipPoll;   // the input the drawn ship's pose shows was read, later than inputPoll when it is late latched
+    double simDone;    // this frame's ticks were stepped
+    double drawSubmit; // everything was handed over, right before the swap
+    double swap;       // the swap returned
+} frame_times_t;
+
+typedef struct latency_stats_t
+{
+    int histogram[LATENCY_BUCKETS]; // frames per ms of input poll to swap
+    double p50;                     // ms, input poll to swap, the latency of everything the input does
+    double p99;
+    double max;
+    double shipP50; // ms, ship poll to swap, only the drawn pose gets this
+    double shipP99;
+    double startToSim; // ms, averages of each part
+    double simToSubmit;
+    double submitToSwap;
+} latency_stats_t;
+
+// ring of the last LATENCY_FRAMES frames
+typedef struct latency_tracker_t
+{
+    frame_times_t frame[LATENCY_FRAMES];
+    int next;
+    int count;
+} latency_tracker_t;
+
+void RecordFrameTimes(latency_tracker_t *tracker, frame_times_t times);
+latency_stats_t GetLatencyStats(const latency_tracker_t *tracker);
+// seconds, the longest start to swap of the last frames. a frame that starts this long before its swap is due
+// makes it in time
+double FrameWorkEstimate(const latency_tracker_t *tracker, int frames);
+
+#endif
@@ -0,0 +1,171 @@
+// synthetic load for ./server: many scripted clients on one epoll loop, meant for loopback
+// usage: ./loadgen [--server host:port] [--clients n] [--seconds n] [--view-width n] [--view-height n]
+// each client flies its own session and asks only for a view of the given size around its ship.
+// prints what a client costs in bytes per second each way and checks every snapshot decodes
+#include "game.h"
+#include "net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+const int loadTickRate = 60;
+const int connectRetryTicks = 15;
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// same pilot as ./headless, shifted per client so they do not all move in lockstep
+static unsigned int ScriptedInput(long tick)
+{
+    unsigned int input = inputFire | inputRight;
+    if ((tick / 120) % 2 == 0)
+        input |= inputThrust;
+    return input;
+}
+
+static Rectangle ViewAround(const net_client_t *client, float width, float height)
+{
+    const snapshot_record_t *latest = LatestSnapshot(client);
+    Vector2 center = latest != NULL ? latest->player.center : (Vector2){screenWidth / 2, screenHeight / 2};
+    return (Rectangle){center.x - width / 2, center.y - height / 2, width, height};
+}
+
+int main(int argc, char **argv)
+{
+    char address[256];
+    snprintf(address, sizeof(address), "127.0.0.1:%i", defaultServerPort);
+    int clientCount = 100;
+    double seconds = 10;
+    float viewWidth = screenWidth;
+    float viewHeight = screenHeight;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--server") == 0)
+            snprintf(address, sizeof(address), "%s", argv[i + 1]);
+        else if (strcmp(argv[i], "--clients") == 0)
+            clientCount = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seconds") == 0)
+            seconds = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--view-width") == 0)
+            viewWidth = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--view-height") == 0)
+            viewHeight = atof(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    net_client_t *clients = calloc(clientCount, sizeof(net_client_t));
+    int epoll = epoll_create1(0);
+    int timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (clients == NULL || epoll == -1 || timer == -1)
+    {
+        fprintf(stderr, "failed to set up the event loop\n");
+        return 1;
+    }
+    for (int i = 0; i < clientCount; i++)
+    {
+        if (!OpenNetClient(&clients[i], address))
+        {
+            fprintf(stderr, "failed to open client %i for %s\n", i, address);
+            return 1;
+        }
+        struct epoll_event event = {.events = EPOLLIN, .data.u32 = i};
+        epoll_ctl(epoll, EPOLL_CTL_ADD, clients[i].socket, &event);
+    }
+    long period = 1000000000L / loadTickRate;
+    struct itimerspec interval = {.it_interval = {0, period}, .it_value = {0, period}};
+    timerfd_settime(timer, 0, &interval, NULL);
+    struct epoll_event timerEvent = {.events = EPOLLIN, .data.u32 = clientCount};
+    epoll_ctl(epoll, EPOLL_CTL_ADD, timer, &timerEvent);
+
+    long tick = 0;
+    long entitiesSeen = 0;
+    uint8_t packet[NET_MAX_PACKET];
+    struct epoll_event events[256];
+    double start = Now();
+    while (Now() - start < seconds)
+    {
+        int count = epoll_wait(epoll, events, 256, 100);
+        for (int e = 0; e < count; e++)
+        {
+            uint32_t index = events[e].data.u32;
+            if (index == (uint32_t)clientCount)
+            {
+                uint64_t expirations;
+                if (read(timer, &expirations, sizeof(expirations)) != sizeof(expirations))
+                    continue;
+                for (int i = 0; i < clientCount; i++)
+                {
+                    net_client_t *client = &clients[i];
+                    if (client->tickRate != 0)
+                    {
+                        SendNetInput(client, ScriptedInput(tick + i * 7), ViewAround(client, viewWidth, viewHeight));
+                    }
+                    else if (tick % connectRetryTicks == 0)
+                    {
+                        size_t size = WriteConnectPacket(packet);
+                        if (send(client->socket, packet, size, 0) > 0)
+                            client->bytesOut += size;
+                    }
+                }
+                tick++;
+                continue;
+            }
+
+            net_client_t *client = &clients[index];
+            ssize_t received;
+            while ((received = recv(client->socket, packet, sizeof(packet), 0)) > 0)
+            {
+                if (PacketType(packet, received) == packetWelcome)
+                {
+                    client->bytesIn += received;
+                    ReadWelcomePacket(packet, received, &client->config, &client->tickRate);
+                }
+                else if (HandleNetClientPacket(client, packet, received))
+                {
+                    entitiesSeen += LatestSnapshot(client)->count;
+                }
+            }
+        }
+    }
+    double elapsed = Now() - start;
+
+    int connected = 0;
+    long bytesIn = 0, bytesOut = 0, snapshots = 0, rejected = 0;
+    for (int i = 0; i < clientCount; i++)
+    {
+        connected += clients[i].tickRate != 0;
+        bytesIn += clients[i].bytesIn;
+        bytesOut += clients[i].bytesOut;
+        snapshots += clients[i].snapshots;
+        rejected += clients[i].rejected;
+        CloseNetClient(&clients[i]);
+    }
+    printf("clients:              %i of %i connected\n"
+           "seconds:              %.2f\n"
+           "snapshots/client/s:   %.1f\n"
+           "entities/snapshot:    %.1f\n"
+           "bytes/client/s in:    %.0f\n"
+           "bytes/client/s out:   %.0f\n"
+           "rejected snapshots:   %li\n",
+           connected, clientCount, elapsed,
+           snapshots / elapsed / clientCount,
+           snapshots > 0 ? (double)entitiesSeen / snapshots : 0,
+           bytesIn / elapsed / clientCount, bytesOut / elapsed / clientCount, rejected);
+    free(clients);
+    close(timer);
+    close(epoll);
+    return rejected > 0 ? 2 : 0;
+}
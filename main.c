@@ -1,531 +1,478 @@
 #include "raylib.h"
-#include <math.h>
+#include "capture.h"
+#include "game.h"
+#include "latency.h"
+#include "net.h"
+#include "render.h"
+#include "replay.h"
+#include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include <stdlib.h>
 
 // comment out developer mode to hide developer overlay
 #define DEVELOPER_MODE
 
-const int screenWidth = 1920;
-const int screenHeight = 1080;
-const float drag = 0.99f;     // default drag when not pressing W
-const float brakeDrag = 0.9f; // drag when pressing S
-const int targetFPS = 60;
-const int maxBullets = 300;             // amount of bullets shot before they are recycled
-const float defaultFireCooldown = 0.1f; // time between shots in seconds
-const int maxAsteroids = 2;             // amount of asteroids before they are recycled
-const float timeBetweenAsteroidSpawn = 10;
-const float asteroidSpeedConstant = 200; // min speed will be this/max size, max speed will be this/min size
-const int asteroidMaxSize = 100;
-const int asteroidMinSize = 30;
-const float invincibleDuration = 2; // invincibility time after taking damage in seconds
-
-typedef enum game_state_e
+const int targetFPS = 60;         // default render rate, the simulation ticks at config.tickRate whatever this is
+const int maxTicksPerFrame = 8; // a frame that needs more drops the rest, the game slows down instead of falling behind
+const int labelCapacity = 1024; // asteroid ids past this draw without a debug label
+const int graphX = 10;          // frame time graph, newest frame on the right
+const int graphY = 1060;
+const int graphBarWidth = 2;
+const float graphPixelsPerMs = 8;
+const double connectTimeout = 3; // seconds to wait for the server's welcome
+const int defaultParticles = 8192;       // particle storage, bursts are cut short while it is full
+const float defaultParticleBudget = 10; // ms of frame work, past it effects spawn fewer particles
+const double particleStatsPeriod = 1;   // seconds the overlay's count of cut particles covers before it restarts
+const int latencyWindow = 30;         // frames whose slowest one decides how early low latency mode starts a frame
+const double latencySlack = 0.001;    // seconds started earlier still, for a frame slower than all of those
+const int latencyGraphX = 1500;       // input latency histogram, 1 ms per bar
+const int latencyGraphY = 1060;
+const int latencyBarWidth = 8;
+
+unsigned int ReadPlayerInput(void)
 {
-    gameStatePlaying,
-    gameStateDead
-} game_state_e;
-
-game_state_e state = gameStatePlaying;
+    unsigned int input = 0;
+    if (IsKeyDown(KEY_W))
+        input |= inputThrust;
+    if (IsKeyDown(KEY_A))
+        input |= inputLeft;
+    if (IsKeyDown(KEY_S))
+        input |= inputBrake;
+    if (IsKeyDown(KEY_D))
+        input |= inputRight;
+    if (IsKeyDown(KEY_SPACE))
+        input |= inputFire;
+    return input;
+}
 
-typedef struct entity_t
+static Vector2 LerpPoint(Vector2 from, Vector2 to, float alpha)
 {
-    Vector2 center;
-    Vector2 velocity;
-    double angle;
-    float rotation;
-    float speed;
-    float size;
-    float hp;
-} entity_t;
+    return (Vector2){from.x + (to.x - from.x) * alpha, from.y + (to.y - from.y) * alpha};
+}
 
-typedef struct player_data_t
+// lateInput, when there is one, draws the ship ahead of the latest tick with it instead of between the last two
+void RenderPlayer(const world_t *world, float alpha, const unsigned int *lateInput)
 {
-    entity_t *player;
-    bool *playerIsInvincible;
-    bool *playerIsWhite;
-    float *timeSpentInvincible;
-    float *invincibleColorSwitchCheck;
-    int *score;
-    Vector2 *triangleA;
-    Vector2 *triangleB;
-    Vector2 *triangleC;
-} player_data_t;
+    Vector2 a = LerpPoint(world->previousTriangleA, world->triangleA, alpha);
+    Vector2 b = LerpPoint(world->previousTriangleB, world->triangleB, alpha);
+    Vector2 c = LerpPoint(world->previousTriangleC, world->triangleC, alpha);
+    Vector2 center = PlayerCenterAt(world, alpha);
+    if (lateInput != NULL)
+        center = PredictPlayerTriangle(world, *lateInput, alpha, &a, &b, &c);
+    if (world->playerIsWhite)
+    {
+        DrawTriangle(a, b, c, WHITE);
+    }
+    else
+    {
+        DrawTriangle(a, b, c, RED);
+    }
 
-typedef struct bullet_data_t
-{
-    entity_t *bullet;
-    int *bulletPointer;
-    float *timeSinceLastShot;
-    float *fireCooldown;
-    int *bulletsOnScreen;
-    int *bulletsOnScreenPointer;
-} bullet_data_t;
+    DrawCircleV(c, 3, GREEN);
+    DrawCircleV(center, 3, GREEN);
+}
 
-typedef struct asteroid_data_t
+#ifdef DEVELOPER_MODE
+void DrawProfilerOverlay(const profiler_t *profiler)
 {
-    entity_t *asteroid;
-    int *asteroidPointer;
-    float *timeSinceLastAsteroidSpawn;
-    int *asteroidsOnScreen;
-    int *asteroidsOnScreenPointer;
-} asteroid_data_t;
-// TODO figure out where to put this
-/*void CheckForPlayerAsteroidCollision() {
-    if ((CheckCollisionPointCircle(triangleA, asteroid.center, asteroid.size) ||
-                     CheckCollisionPointCircle(triangleB, asteroid.center, asteroid.size) ||
-                     CheckCollisionPointCircle(triangleC, asteroid.center, asteroid.size)) &&
-                    !playerIsInvincible)
-                {
-                    player.hp--;
-                    playerIsInvincible = true;
-                    playerIsWhite = true;
-                }
-}*/
-
-void RenderAsteroids(asteroid_data_t asteroidData) {
-    for (int i = 0; i < maxAsteroids; i++)
-        { // - 5 since starting pos will be -asteroid[i].size at times
-            entity_t asteroid = asteroidData.asteroid[i];
-            if ((asteroid.center.x >= -asteroid.size - 5 && asteroid.center.x <= screenWidth + asteroid.size + 5) &&
-                (asteroid.center.y >= -asteroid.size - 5 && asteroid.center.y <= screenHeight + asteroid.size + 5) &&
-                asteroid.hp > 0)
-            {
-                asteroidData.asteroidsOnScreen[*asteroidData.asteroidsOnScreenPointer] = i;
-                *asteroidData.asteroidsOnScreenPointer++;
-                asteroid.center.x += asteroid.velocity.x;
-                asteroid.center.y += asteroid.velocity.y;
-                DrawCircleV(asteroid.center, asteroid.size, BROWN);
-                DrawText(TextFormat("%i-%.2f", i, asteroid.size), asteroid.center.x, asteroid.center.y, 10, GREEN);
-            }
-        }
+    for (int phase = 0; phase <= phaseCount; phase++)
+    {
+        profile_stats_t stats = GetProfileStats(profiler, phase);
+        DrawText(TextFormat("%-12s p50 %6.3f  p99 %6.3f  max %6.3f ms", profilePhaseNames[phase], stats.p50, stats.p99, stats.max),
+                 10, 200 + phase * 22, 20, GREEN);
+    }
+    if (profiler->spikeFrame != -1)
+        DrawText(TextFormat("last spike: frame %li, %.2f ms, mostly %s",
+                            profiler->spikeFrame, profiler->spikeTime / 1e6, profilePhaseNames[profiler->spikePhase]),
+                 10, 200 + (phaseCount + 1) * 22, 20, RED);
+
+    float times[PROFILE_FRAMES];
+    int count = GetFrameTimes(profiler, times, PROFILE_FRAMES);
+    for (int i = 0; i < count; i++)
+    {
+        int height = (int)(times[i] * graphPixelsPerMs);
+        int x = graphX + (PROFILE_FRAMES - 1 - i) * graphBarWidth;
+        DrawRectangle(x, graphY - height, graphBarWidth, height, times[i] > 1000.0f / targetFPS ? RED : GREEN);
+    }
+    int budget = graphY - (int)(1000.0f / targetFPS * graphPixelsPerMs);
+    DrawLine(graphX, budget, graphX + PROFILE_FRAMES * graphBarWidth, budget, YELLOW);
 }
 
-void RenderBullets(bullet_data_t bulletData) {
-    for (int i = 0; i < maxBullets; i++)
-        {
-            entity_t bullet = bulletData.bullet[i];
-
-            if ((bullet.center.x >= -bullet.size && bullet.center.x <= screenWidth + bullet.size) &&
-                (bullet.center.y >= -bullet.size && bullet.center.y <= screenHeight + bullet.size) &&
-                bullet.hp > 0)
-            {
-                bulletData.bulletsOnScreen[*bulletData.bulletsOnScreenPointer] = i;
-                *bulletData.bulletsOnScreenPointer++;
-                bullet.center.x += bullet.velocity.x;
-                bullet.center.y += bullet.velocity.y;
-                DrawCircleV(bullet.center, bullet.size, BLUE);
-            }
-        }
+void DrawLatencyOverlay(const latency_tracker_t *latency, bool lowLatency)
+{
+    latency_stats_t stats = GetLatencyStats(latency);
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+        DrawRectangle(latencyGraphX + i * latencyBarWidth, latencyGraphY - stats.histogram[i], latencyBarWidth - 1,
+                      stats.histogram[i], i < 1000 / targetFPS ? GREEN : RED);
+    DrawText(TextFormat("input to swap%s: p50 %.1f  p99 %.1f  max %.1f ms\n"
+                        "ship pose input to swap: p50 %.1f  p99 %.1f ms\n"
+                        "start to sim %.2f, to submit %.2f, to swap %.2f ms",
+                        lowLatency ? " (low latency)" : "", stats.p50, stats.p99, stats.max,
+                        stats.shipP50, stats.shipP99, stats.startToSim, stats.simToSubmit, stats.submitToSwap),
+             latencyGraphX, latencyGraphY + 2, 10, GREEN);
 }
+#endif
 
-void Render(player_data_t playerData, bullet_data_t bulletData, asteroid_data_t asteroidData)
+// alpha is how far the frame sits between the previous tick (0) and the latest one (1)
+void Render(renderer_t *renderer, const world_t *world, const particle_system_t *particles, float alpha,
+            const unsigned int *lateInput)
 {
-    switch (state)
+    // the camera follows the player over a chunked field, the classic field is exactly the screen
+    Rectangle view = WorldView(world, alpha);
+    Camera2D camera = {.target = {view.x, view.y}, .zoom = 1};
+    ProfileBegin(world->profiler, phaseRenderList);
+    BuildRenderList(renderer, world, view, alpha);
+    ProfileEnd(world->profiler, phaseRenderList);
+    ProfileBegin(world->profiler, phaseDraw);
+    BeginMode2D(camera);
+    DrawRenderList(renderer);
+    DrawParticles(renderer, particles);
+    switch (world->state)
     {
     case gameStatePlaying:
-        RenderBullets(bulletData);
+        RenderPlayer(world, alpha, lateInput);
         break;
     case gameStateDead:
         break;
     }
-}
-void SpawnAsteroid(entity_t *asteroid, int *asteroidPointer)
-{
-    float hp = asteroid->size / 5;
-    float speed = asteroidSpeedConstant / asteroid->size;
-    Vector2 velocity = {speed * cos(asteroid->angle),
-                        speed * sin(asteroid->angle)};
-    *asteroid = (entity_t){
-        .velocity = velocity,
-        .speed = speed,
-        .hp = hp};
-    *asteroidPointer = *asteroidPointer >= (maxAsteroids - 1) ? 0 : *asteroidPointer + 1;
-}
-void SpawnAsteroid(entity_t *asteroid, Vector2 center, float size, float angle, int *asteroidPointer)
-{
-    float hp = size / 5;
-    float speed = asteroidSpeedConstant / size;
-    Vector2 velocity = {speed * cos(angle),
-                        speed * sin(angle)};
-    *asteroid = (entity_t){
-        .center = center,
-        .velocity = velocity,
-        .angle = angle,
-        .speed = speed,
-        .size = size,
-        .hp = hp};
-    *asteroidPointer = *asteroidPointer >= (maxAsteroids - 1) ? 0 : *asteroidPointer + 1;
+#ifdef DEVELOPER_MODE
+    DrawAsteroidLabels(renderer, world, view, alpha);
+#endif
+    EndMode2D();
+#ifdef DEVELOPER_MODE
+    DrawText(TextFormat("bullets on screen:   %i/%i\n"
+                        "asteroids on screen: %i/%i\n"
+                        "asteroids parked:    %i/%i\n"
+                        "view x.y :           %.0f.%.0f\n"
+                        "particles:           %i/%i, spawning %.0f%%, cut %i of %i this second\n"
+                        "asteroid 0 x.y :     %.2f.%.2f\n"
+                        "renderer draw calls: %i\n"
+                        "vertices:            %i\n"
+                        "label updates:       %i",
+                        world->bullet.pool.count, world->config.maxBullets,
+                        world->asteroid.pool.count, world->config.maxAsteroids,
+                        world->field.count, world->field.capacity,
+                        view.x, view.y,
+                        particles->count, particles->capacity, particles->spawnScale * 100,
+                        particles->requested - particles->spawned, particles->requested,
+                        world->asteroid.x[0], world->asteroid.y[0],
+                        renderer->stats.drawCalls, renderer->stats.vertices, renderer->stats.labelUpdates),
+             10, 10, 25, GREEN);
+    DrawProfilerOverlay(world->profiler);
+#endif
+    ProfileEnd(world->profiler, phaseDraw);
+    // DrawText(TextFormat("lives remaining: %.0f\n"
+    //                     "score:            %i",
+    //                     world->player.hp, world->score),
+    //          10, 10, 25, GREEN);
 }
 
-void GetRandomAsteroidSpawn(entity_t *asteroid)
+// usage: ./game [--frames n] [--seed n] [--record file] [--trace file] [--connect host:port] [--capture path]
+//               [--chunks n] [--field-asteroids n] [--fps n] [--tick-rate n] [--particles n] [--particle-budget ms]
+//        ./game --replay file [--capture path] [--fps n] [--frames n] [--particles n]
+// both take [--low-latency 0|1]
+// --frames quits after n frames and prints the last frame's render stats, for software gl test runs
+// --record logs the session for ./headless --replay
+// --trace writes every phase timing as chrome trace_event json on exit, open it in ui.perfetto.dev
+// --connect plays on ./server, the local world only mirrors its snapshots and the seed comes from the server
+// --fps caps rendering at n frames per second, 0 leaves it uncapped. frames are drawn between ticks, so any rate
+//   plays the same game
+// --tick-rate simulates n ticks per second instead of 60, a cheaper rate plays the same game in coarser steps
+// --particles sets how many effect particles can exist at once, 0 turns effects off. --particle-budget is the ms
+//   of work per frame above which effects back off, they come back once frames are cheap again
+// --chunks plays on a walled field of n x n chunks instead of one screen, filled with --field-asteroids asteroids
+// --capture records what is drawn, into one raw video if the path ends in .y4m, otherwise as a png sequence named
+//   path000000.png on. frames the writer cannot keep up with are dropped and counted, the game never waits for it
+// --replay re-renders a --record log in a hidden window as fast as it draws, one frame per 1/--fps seconds of game
+//   time. with --capture no frame is dropped, so LIBGL_ALWAYS_SOFTWARE=1 on a machine without a gpu still gives
+//   every frame, just slower
+// --low-latency 1 waits before reading input instead of after the swap, starting each frame only as early as the
+//   slowest recent one needed, and reads input once more right before drawing to place the ship. the overlay and
+//   the --frames summary show input to swap latency either way, to compare the two. the headline is the input the
+//   ticks stepped with, fire and the real turn and thrust wait that long. the ship pose line is the late read,
+//   which only moves the drawn ship
+int main(int argc, char **argv)
 {
-    float size = (rand() % (asteroidMaxSize - asteroidMinSize + 1)) + asteroidMinSize; // picks a random value between the min and max asteroid size
-    asteroid->size = size;
-    switch (rand() % 4)
+    long frames = -1;
+    world_config_t config = DefaultWorldConfig();
+    config.seed = (unsigned int)time(NULL);
+    const char *recordPath = NULL;
+    const char *tracePath = NULL;
+    const char *serverAddress = NULL;
+    const char *capturePath = NULL;
+    const char *playbackPath = NULL;
+    int chunks = 0;
+    int fieldAsteroids = 0;
+    int fps = targetFPS;
+    int particleCapacity = defaultParticles;
+    float particleBudget = defaultParticleBudget;
+    bool lowLatency = false;
+    for (int i = 1; i + 1 < argc; i += 2)
     {
-    case 0: // start in left corner
-        asteroid->center.x = -asteroid->size;
-        asteroid->center.y = rand() % screenHeight;
-        asteroid->angle = (rand() % (int)(100 * PI) / 100) - PI / 2; // (-90)-90 degrees
-        break;
-
-    case 1: // start in right corner
-        asteroid->center.x = screenWidth + size;
-        asteroid->center.y = rand() % screenHeight;
-        asteroid->angle = (rand() % (int)(100 * PI) / 100) + PI / 2; // 90-270 degrees
-        break;
-
-    case 2: // start in bottom
-        asteroid->center.x = rand() % screenWidth;
-        asteroid->center.y = -size;
-        asteroid->angle = (rand() % (int)(100 * PI) / 100); // 0-180 degrees
-        break;
-
-    case 3: // start in top
-        asteroid->center.x = rand() % screenWidth;
-        asteroid->center.y = screenHeight + size;
-        asteroid->angle = (rand() % (int)(100 * PI) / 100) + PI; // 180-360 degrees
-        break;
+        if (strcmp(argv[i], "--frames") == 0)
+            frames = atol(argv[i + 1]);
+        else if (strcmp(argv[i], "--seed") == 0)
+            config.seed = (unsigned int)atol(argv[i + 1]);
+        else if (strcmp(argv[i], "--record") == 0)
+            recordPath = argv[i + 1];
+        else if (strcmp(argv[i], "--trace") == 0)
+            tracePath = argv[i + 1];
+        else if (strcmp(argv[i], "--connect") == 0)
+            serverAddress = argv[i + 1];
+        else if (strcmp(argv[i], "--capture") == 0)
+            capturePath = argv[i + 1];
+        else if (strcmp(argv[i], "--replay") == 0)
+            playbackPath = argv[i + 1];
+        else if (strcmp(argv[i], "--chunks") == 0)
+            chunks = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--field-asteroids") == 0)
+            fieldAsteroids = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--fps") == 0)
+            fps = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--tick-rate") == 0)
+            config.tickRate = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--particles") == 0)
+            particleCapacity = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--particle-budget") == 0)
+            particleBudget = (float)atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--low-latency") == 0)
+            lowLatency = atoi(argv[i + 1]) != 0;
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
     }
-}
-// checks if astroid should spawn, and spawns one if it should
-void HandleAstroidSpawn(asteroid_data_t asteroidData)
-{
-    if (*asteroidData.timeSinceLastAsteroidSpawn >= *asteroidData.timeSinceLastAsteroidSpawn)
+    if (argc % 2 == 0)
     {
-        GetRandomAsteroidSpawn(&asteroidData.asteroid[*asteroidData.asteroidPointer]);
-        SpawnAsteroid(&asteroidData.asteroid[*asteroidData.asteroidPointer], asteroidData.asteroidPointer);
+        fprintf(stderr, "%s needs a value\n", argv[argc - 1]);
+        return 1;
     }
-}
-
-
-void UpdatePlayerPosition(entity_t *player)
-{
-    player->center.x += player->velocity.x;
-    player->center.y += player->velocity.y;
-}
-
-void SpawnBullet(entity_t *bullet, int *bulletPointer, double playerAngle, Vector2 playerFront)
-{
-    bullet[*bulletPointer].angle = playerAngle;
-    bullet[*bulletPointer].velocity.x = bullet[*bulletPointer].speed * cos(playerAngle);
-    bullet[*bulletPointer].velocity.y = bullet[*bulletPointer].speed * sin(playerAngle);
-    bullet[*bulletPointer].center = playerFront;
-    bullet[*bulletPointer].hp = 1;
-}
-
-void CalculatePlayerPosition(player_data_t playerData)
-{
-    entity_t player = *playerData.player; // copied for simplicity in code
-    *playerData.triangleA = (Vector2){player.center.x + 2 * player.size / 3 * cos(player.angle + 2 * PI - ((4 * PI) / 6)),
-                                      player.center.y + 2 * player.size / 3 * sin(player.angle + 2 * PI - ((4 * PI) / 6))};
-
-    *playerData.triangleB = (Vector2){player.center.x + 2 * player.size / 3 * cos(player.angle + (4 * PI) / 6),
-                                      player.center.y + 2 * player.size / 3 * sin(player.angle + (4 * PI) / 6)};
-
-    *playerData.triangleC = (Vector2){player.center.x + player.size * cos(player.angle),
-                                      player.center.y + player.size * sin(player.angle)};
-}
-
-void HandlePlayerInput(entity_t *player, bullet_data_t bulletData, Vector2 playerFront)
-{
-    if (IsKeyDown(KEY_A))
-        player->angle -= player->rotation;
-    if (IsKeyDown(KEY_D))
-        player->angle += player->rotation;
-    if (IsKeyDown(KEY_W))
+    if (config.tickRate < minTickRate)
     {
-        player->velocity.x = player->speed * cos(player->angle);
-        player->velocity.y = player->speed * sin(player->angle);
+        fprintf(stderr, "--tick-rate must be at least %i\n", minTickRate);
+        return 1;
     }
-    else
+    if (chunks > 0)
+        config = ChunkedWorldConfig(config, chunks, fieldAsteroids);
+    if (serverAddress != NULL && recordPath != NULL)
     {
-        player->velocity.x *= drag;
-        player->velocity.y *= drag;
+        fprintf(stderr, "--record needs the simulation to run locally, it cannot be used with --connect\n");
+        return 1;
     }
-    if (IsKeyDown(KEY_S))
+    if (playbackPath != NULL && (serverAddress != NULL || recordPath != NULL || fps <= 0))
     {
-        player->velocity.x *= brakeDrag;
-        player->velocity.y *= brakeDrag;
+        fprintf(stderr, "--replay takes its inputs from the log, it needs --fps above 0 and no --connect or --record\n");
+        return 1;
     }
-    if (IsKeyDown(KEY_SPACE))
+
+    net_client_t client = {.socket = -1};
+    if (serverAddress != NULL)
     {
-        if (*bulletData.timeSinceLastShot >= *bulletData.fireCooldown)
+        if (!OpenNetClient(&client, serverAddress) || !ConnectNetClient(&client, connectTimeout))
         {
-            SpawnBullet(bulletData.bullet, bulletData.bulletPointer, player->angle, playerFront);
+            fprintf(stderr, "could not reach a server at %s\n", serverAddress);
+            CloseNetClient(&client);
+            return 1;
         }
+        config = client.config;
     }
-}
 
-void HandleInvincibility(player_data_t playerData)
-{
-    if (*playerData.playerIsInvincible)
+    replay_file_t replay = {0};
+    if (recordPath != NULL && !OpenReplayForWriting(&replay, recordPath, config))
     {
-        *playerData.timeSpentInvincible += GetFrameTime();
-        // this will make the ship switch between white and red faster and faster
-        *playerData.invincibleColorSwitchCheck += powf(20, (*playerData.timeSpentInvincible / invincibleDuration));
+        fprintf(stderr, "failed to open %s\n", recordPath);
+        return 1;
     }
-    // if invincible duration is over
-    if (*playerData.timeSpentInvincible >= invincibleDuration)
-    {
-        *playerData.playerIsInvincible = false;
-        *playerData.playerIsWhite = false;
-        *playerData.timeSpentInvincible = 0;
-        *playerData.invincibleColorSwitchCheck = 0;
-    }
-}
-
-void UpdateTimeVariables(float *timeSinceLastShot, float *timeSinceLastAstroidSpawn)
-{
-    *timeSinceLastShot += GetFrameTime();
-    *timeSinceLastAstroidSpawn += GetFrameTime();
-}
-
-void Update(player_data_t playerData, bullet_data_t bulletData, asteroid_data_t asteroidData)
-{
-    switch (state)
+    replay_file_t playback = {0};
+    if (playbackPath != NULL)
     {
-    case gameStatePlaying:
-        UpdateTimeVariables(bulletData.timeSinceLastShot, asteroidData.timeSinceLastAsteroidSpawn);
-        HandleInvincibility(playerData);
-        HandlePlayerInput(playerData.player, bulletData, *playerData.triangleC);
-        UpdatePlayerPosition(playerData.player);
-        HandleAstroidSpawn(asteroidData);
-        break;
-    case gameStateDead:
-        break;
+        if (!OpenReplayForReading(&playback, playbackPath))
+        {
+            fprintf(stderr, "failed to read %s\n", playbackPath);
+            return 1;
+        }
+        config = playback.header.config;
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
     }
-}
 
-void InitGame(entity_t *player, entity_t *bullet, entity_t *asteroid, int *score)
-{
-    // init player
-    *player = (entity_t){.center = (Vector2){screenWidth / 2, screenHeight / 2},
-                         .velocity = (Vector2){0, 0},
-                         .angle = 0,
-                         .rotation = 0.1f,
-                         .speed = 5.0f,
-                         .size = 50.0f,
-                         .hp = 5};
-
-    // init bullets
-    for (int i = 0; i < maxBullets; i++)
+    InitWindow(screenWidth, screenHeight, "asteroids");
+    // frames are paced here instead of in EndDrawing, so the wait can go before input is read.
+    // a replay is drawn as fast as it renders, every frame still steps the same game time
+    SetTargetFPS(0);
+    double framePeriod = playbackPath == NULL && fps > 0 ? 1.0 / fps : 0;
+    float fixedFrameTime = playbackPath != NULL ? 1.0f / fps : 0;
+
+    capture_t capture = {0};
+    if (capturePath != NULL &&
+        !StartCapture(&capture, capturePath, screenWidth, screenHeight, fps > 0 ? fps : targetFPS, playbackPath != NULL))
     {
-        bullet[i] = (entity_t){
-            .center = {-10, -10},
-            .velocity = {0, 0},
-            .angle = 0,
-            .rotation = 0,
-            .speed = 15,
-            .size = 5,
-            .hp = 1};
+        fprintf(stderr, "failed to start capturing to %s\n", capturePath);
+        CloseReplay(&playback);
+        CloseReplay(&replay);
+        CloseWindow();
+        return 1;
     }
 
-    // init asteroids
-    for (int i = 0; i < maxAsteroids; i++)
+    world_t *world = CreateWorld(config);
+    renderer_t renderer;
+    profiler_t profiler = {0};
+    particle_system_t particles = {0};
+    if (world == NULL || !InitProfiler(&profiler, tracePath != NULL) ||
+        !InitParticles(&particles, particleCapacity > 0 ? particleCapacity : 0, particleBudget / 1000) ||
+        !InitRenderer(&renderer, world->config.maxBullets + world->config.maxAsteroids, labelCapacity))
     {
-        asteroid[i] = (entity_t){
-            .center = {-25, -25},
-            .velocity = {0, 0},
-            .angle = 0,
-            .rotation = 0,
-            .speed = 3,
-            .size = 25,
-            .hp = 10};
+        if (capturePath != NULL)
+            StopCapture(&capture);
+        FreeParticles(&particles);
+        FreeProfiler(&profiler);
+        DestroyWorld(world);
+        CloseReplay(&playback);
+        CloseReplay(&replay);
+        CloseNetClient(&client);
+        CloseWindow();
+        return 1;
     }
 
-    *score = 0;
-    state = gameStatePlaying;
-}
-int main()
-{
-
-    srand(time(NULL));
-    InitWindow(screenWidth, screenHeight, "asteroids");
-    SetTargetFPS(targetFPS);
-    entity_t player;
-
-    bool playerIsInvincible = false;
-    bool playerIsWhite = false;
-    float timeSpentInvincible = 0;
-    float invincibleColorSwitchCheck = 0; // will switch from white to red ship based on how long you have been invincible
-    int score = 0;
-
-    Vector2 triangleA = {player.center.x + 2 * player.size / 3 * cos(player.angle + 2 * PI - ((4 * PI) / 6)),
-                         player.center.y + 2 * player.size / 3 * sin(player.angle + 2 * PI - ((4 * PI) / 6))};
-
-    Vector2 triangleB = {player.center.x + 2 * player.size / 3 * cos(player.angle + (4 * PI) / 6),
-                         player.center.y + 2 * player.size / 3 * sin(player.angle + (4 * PI) / 6)};
-
-    Vector2 triangleC = {player.center.x + player.size * cos(player.angle),
-                         player.center.y + player.size * sin(player.angle)};
-
-    // values are assigned their own structs for better readability and less parameters for some functions
-    player_data_t playerData = {
-        .player = &player,
-        .playerIsInvincible = &playerIsInvincible,
-        .playerIsWhite = &playerIsWhite,
-        .timeSpentInvincible = &timeSpentInvincible,
-        .invincibleColorSwitchCheck = &invincibleColorSwitchCheck,
-        .score = &score,
-        .triangleA = &triangleA,
-        .triangleB = &triangleB,
-        .triangleC = &triangleC};
-
-    entity_t bullet[maxBullets];
-    int bulletPointer = 0;
-    float timeSinceLastShot = 0;
-    float fireCooldown = defaultFireCooldown;
-    int bulletsOnScreen[maxBullets];
-    int bulletsOnScreenPointer = 0;
-
-    bullet_data_t bulletData = {
-        .bullet = bullet,
-        .bulletPointer = &bulletPointer,
-        .timeSinceLastShot = &timeSinceLastShot,
-        .fireCooldown = &fireCooldown,
-        .bulletsOnScreen = bulletsOnScreen,
-        .bulletsOnScreenPointer = &bulletsOnScreenPointer};
-
-    entity_t asteroid[maxAsteroids];
-    int asteroidPointer = 0;
-    float timeSinceLastAstroidSpawn = 0;
-    int asteroidsOnScreen[maxAsteroids];
-    int asteroidsOnScreenPointer = 0;
-
-    asteroid_data_t asteroidData = {
-        .asteroid = asteroid,
-        .asteroidPointer = &asteroidPointer,
-        .timeSinceLastAsteroidSpawn = &timeSinceLastAstroidSpawn,
-        .asteroidsOnScreen = asteroidsOnScreen,
-        .asteroidsOnScreenPointer = &asteroidsOnScreenPointer};
+    world->profiler = &profiler;
 
-    InitGame(playerData.player, bulletData.bullet, asteroidData.asteroid, playerData.score);
-
-    while (!WindowShouldClose())
+    double accumulator = 0; // seconds of real time not simulated yet, always under one tick after stepping
+    bool playbackEnded = false;
+    long desyncTick = -1;
+    latency_tracker_t latency = {0};
+    double lastSwap = GetTime(); // EndDrawing polls input right after it swaps
+    double particleStatsStart = GetTime();
+    for (long frame = 0; !WindowShouldClose() && frame != frames && !playbackEnded; frame++)
     {
-
-        Update(playerData, bulletData, asteroidData);
-        Render(playerData, bulletData, asteroidData);
-
-        // RENDER ////////////////////////////////////////////////////////////////////
-        BeginDrawing();
-        ClearBackground(BLACK);
-
-        // loop through all bullets
-        for (int i = 0; i < maxBullets; i++)
+        // at the start of a frame, so the overlay always covers at least this frame's bursts
+        if (GetTime() - particleStatsStart >= particleStatsPeriod)
         {
-            if ((bullet[i].center.x >= -bullet[i].size && bullet[i].center.x <= screenWidth + bullet[i].size) &&
-                (bullet[i].center.y >= -bullet[i].size && bullet[i].center.y <= screenHeight + bullet[i].size) &&
-                bullet[i].hp > 0)
-            {
-                bulletsOnScreen[bulletsOnScreenPointer] = i;
-                bulletsOnScreenPointer++;
-                bullet[i].center.x += bullet[i].velocity.x;
-                bullet[i].center.y += bullet[i].velocity.y;
-                DrawCircleV(bullet[i].center, bullet[i].size, BLUE);
-            }
+            ResetParticleStats(&particles);
+            particleStatsStart = GetTime();
         }
-        for (int i = 0; i < maxAsteroids; i++)
-        { // - 5 since starting pos will be -asteroid[i].size at times
-            if ((asteroid[i].center.x >= -asteroid[i].size - 5 && asteroid[i].center.x <= screenWidth + asteroid[i].size + 5) &&
-                (asteroid[i].center.y >= -asteroid[i].size - 5 && asteroid[i].center.y <= screenHeight + asteroid[i].size + 5) &&
-                asteroid[i].hp > 0)
-            {
-                asteroidsOnScreen[asteroidsOnScreenPointer] = i;
-                asteroidsOnScreenPointer++;
-                asteroid[i].center.x += asteroid[i].velocity.x;
-                asteroid[i].center.y += asteroid[i].velocity.y;
-                DrawCircleV(asteroid[i].center, asteroid[i].size, BROWN);
-                DrawText(TextFormat("%i-%.2f", i, asteroid[i].size), asteroid[i].center.x, asteroid[i].center.y, 10, GREEN);
-                if ((CheckCollisionPointCircle(triangleA, asteroid[i].center, asteroid[i].size) ||
-                     CheckCollisionPointCircle(triangleB, asteroid[i].center, asteroid[i].size) ||
-                     CheckCollisionPointCircle(triangleC, asteroid[i].center, asteroid[i].size)) &&
-                    !playerIsInvincible)
-                {
-                    player.hp--;
-                    playerIsInvincible = true;
-                    playerIsWhite = true;
-                }
-            }
+        frame_times_t times = {.inputPoll = lastSwap};
+        if (lowLatency && framePeriod > 0)
+        {
+            // the input polled at the last swap would wait out this sleep, so sleep first and poll after
+            double wake = lastSwap + framePeriod - FrameWorkEstimate(&latency, latencyWindow) - latencySlack;
+            if (GetTime() < wake)
+                WaitTime(wake - GetTime());
+            PollInputEvents();
+            times.inputPoll = GetTime();
         }
-
-        for (int i = 0; i < bulletsOnScreenPointer; i++)
+        // the profiler times the work only, the waits and the swap would make every paced frame a spike
+        ProfileBeginFrame(&profiler);
+        double workStart = GetTime();
+        times.start = workStart;
+        float frameTime = playbackPath != NULL ? fixedFrameTime : GetFrameTime();
+        ProfileBegin(&profiler, phaseInput);
+        unsigned int input = ReadPlayerInput();
+        ProfileEnd(&profiler, phaseInput);
+        float alpha = 1;
+        if (client.socket != -1)
         {
-            for (int j = 0; j < asteroidsOnScreenPointer; j++)
+            // the whole screen is in view, the server sends what is on it
+            SendNetInput(&client, input, (Rectangle){0, 0, screenWidth, screenHeight});
+            if (PollNetClient(&client) > 0)
+                ApplySnapshotRecord(world, LatestSnapshot(&client));
+        }
+        else
+        {
+            // fixed ticks however long the frame took, the frame then shows the world part way into the next one
+            accumulator += frameTime;
+            for (int ticks = 0; accumulator >= world->tickTime && ticks < maxTicksPerFrame; ticks++)
             {
-
-                if (CheckCollisionCircles(bullet[bulletsOnScreen[i]].center, bullet[bulletsOnScreen[i]].size,
-                                          asteroid[asteroidsOnScreen[j]].center, asteroid[asteroidsOnScreen[j]].size))
+                uint32_t expected = 0;
+                if (playback.file != NULL && !ReadReplayTick(&playback, &input, &expected))
                 {
-                    bullet[bulletsOnScreen[i]].hp = 0;
-                    asteroid[asteroidsOnScreen[j]].hp--;
-                    if (asteroid[asteroidsOnScreen[j]].hp <= 0 && asteroid[asteroidsOnScreen[j]].size >= asteroidMinSize * 2) // add 2 new asteroids from the old asteroid
-                    {
-                        score += 10;
-                        float newSpeed = asteroid[asteroidsOnScreen[j]].speed * 2;
-                        float newSize = asteroid[asteroidsOnScreen[j]].size / 2;
-                        float newHP = newSize / 5;
-                        asteroid[asteroidPointer] = (entity_t){
-                            .center = {asteroid[asteroidsOnScreen[j]].center.x + (asteroid[asteroidsOnScreen[j]].size * cos(bullet[bulletsOnScreen[i]].angle + PI / 2) / 2),
-                                       asteroid[asteroidsOnScreen[j]].center.y + (asteroid[asteroidsOnScreen[j]].size * sin(bullet[bulletsOnScreen[i]].angle + PI / 2) / 2)},
-                            .velocity = {newSpeed * cos(bullet[bulletsOnScreen[i]].angle + PI / 2),
-                                         newSpeed * sin(bullet[bulletsOnScreen[i]].angle + PI / 2)},
-                            .angle = bullet[bulletsOnScreen[i]].angle + PI / 2,
-                            .speed = newSpeed,
-                            .size = newSize,
-                            .hp = newHP};
-                        asteroidPointer = asteroidPointer >= maxAsteroids - 1 ? 0 : asteroidPointer + 1;
-                        asteroid[asteroidPointer] = (entity_t){
-                            .center = {asteroid[asteroidsOnScreen[j]].center.x + (asteroid[asteroidsOnScreen[j]].size * cos(bullet[bulletsOnScreen[i]].angle + (3 * PI / 2)) / 2),
-                                       asteroid[asteroidsOnScreen[j]].center.y + (asteroid[asteroidsOnScreen[j]].size * sin(bullet[bulletsOnScreen[i]].angle + (3 * PI / 2)) / 2)},
-                            .velocity = {newSpeed * cos(bullet[bulletsOnScreen[i]].angle + (3 * PI / 2)),
-                                         newSpeed * sin(bullet[bulletsOnScreen[i]].angle + (3 * PI / 2))},
-                            .angle = bullet[bulletsOnScreen[i]].angle + (3 * PI / 2),
-                            .speed = newSpeed,
-                            .size = newSize,
-                            .hp = newHP};
-                        asteroidPointer = asteroidPointer >= maxAsteroids - 1 ? 0 : asteroidPointer + 1;
-                    }
-                    else if (asteroid[asteroidsOnScreen[j]].hp <= 0)
-                    {
-                        score += 10;
-                    }
+                    playbackEnded = true;
+                    break;
                 }
+                StepWorld(world, input);
+                if (playback.file != NULL && desyncTick == -1 && HashWorld(world) != expected)
+                    desyncTick = world->tick;
+                if (replay.file != NULL)
+                    WriteReplayTick(&replay, input, HashWorld(world));
+                ProfileBegin(&profiler, phaseParticles);
+                SpawnWorldEffects(&particles, world);
+                ProfileEnd(&profiler, phaseParticles);
+                accumulator -= world->tickTime;
             }
+            if (accumulator >= world->tickTime)
+                accumulator = 0;
+            alpha = (float)(accumulator / world->tickTime);
         }
-#ifdef DEVELOPER_MODE
-        DrawText(TextFormat("bullets on screen:   %i\n"
-                            "bullet pointer:      %i\n"
-                            "asteroids on screen: %i\n"
-                            "asteroid pointer:    %i\n"
-                            "asteroid 0 x.y :     %.2f.%.2f",
-                            bulletsOnScreenPointer, bulletPointer, asteroidsOnScreenPointer, asteroidPointer, asteroid[0].center.x, asteroid[0].center.y),
-                 10, 10, 25, GREEN);
-#endif
-        // DrawText(TextFormat("lives remaining: %.0f\n"
-        //                     "score:            %i",
-        //                     player.hp, score),
-        //          10, 10, 25, GREEN);
-        if (playerIsInvincible && invincibleColorSwitchCheck >= 60)
+        ProfileBegin(&profiler, phaseParticles);
+        UpdateParticles(&particles, frameTime);
+        ProfileEnd(&profiler, phaseParticles);
+        times.simDone = GetTime();
+
+        // the ticks above took time, input read now can still turn the ship on this frame
+        unsigned int lateInput = input;
+        times.shipPoll = times.inputPoll;
+        if (lowLatency && playback.file == NULL)
         {
-            playerIsWhite = !playerIsWhite;
-            invincibleColorSwitchCheck -= 60;
+            PollInputEvents();
+            times.shipPoll = GetTime();
+            lateInput = ReadPlayerInput();
         }
-        if (playerIsWhite)
-        {
-            DrawTriangle(triangleA, triangleB, triangleC, WHITE);
-        }
-        else
+
+        BeginDrawing();
+        if (capturePath != NULL)
+            BeginCaptureFrame(&capture);
+        ClearBackground(BLACK);
+        Render(&renderer, world, &particles, alpha, lowLatency && playback.file == NULL ? &lateInput : NULL);
+#ifdef DEVELOPER_MODE
+        DrawLatencyOverlay(&latency, lowLatency);
+#endif
+        if (capturePath != NULL)
         {
-            DrawTriangle(triangleA, triangleB, triangleC, RED);
+            ProfileBegin(&profiler, phaseCapture);
+            EndCaptureFrame(&capture);
+            ProfileEnd(&profiler, phaseCapture);
         }
-
-        DrawCircleV(triangleC, 3, GREEN);
-        DrawCircleV(player.center, 3, GREEN);
+        // measured before EndDrawing, which waits out the rest of the frame. a replay has no frame deadline and
+        // keeps every effect
+        if (playbackPath == NULL)
+            AdjustParticleBudget(&particles, (float)(GetTime() - workStart));
+        times.drawSubmit = GetTime();
+        ProfileEndFrame(&profiler);
         EndDrawing();
+        times.swap = GetTime();
+        lastSwap = times.swap;
+        RecordFrameTimes(&latency, times);
+        if (!lowLatency && framePeriod > 0 && GetTime() < workStart + framePeriod)
+            WaitTime(workStart + framePeriod - GetTime());
     }
+    if (frames != -1)
+    {
+        latency_stats_t stats = GetLatencyStats(&latency);
+        printf("renderer draw calls: %i\nvertices: %i\nlabel updates: %i\n"
+               "input to swap: p50 %.2f p99 %.2f max %.2f ms\n"
+               "ship pose input to swap: p50 %.2f p99 %.2f ms\n",
+               renderer.stats.drawCalls, renderer.stats.vertices, renderer.stats.labelUpdates,
+               stats.p50, stats.p99, stats.max, stats.shipP50, stats.shipP99);
+    }
+
+    if (tracePath != NULL && !WriteChromeTrace(&profiler, tracePath))
+        fprintf(stderr, "failed to write %s\n", tracePath);
+    if (desyncTick != -1)
+        fprintf(stderr, "%s desynced at tick %li, the frames after it show a different game\n", playbackPath, desyncTick);
+    if (capturePath != NULL)
+    {
+        StopCapture(&capture);
+        printf("captured %li frames to %s, dropped %li%s\n", capture.written, capturePath, (long)capture.dropped,
+               capture.writeFailed ? ", writing failed" : "");
+    }
+
+    CloseReplay(&playback);
+    CloseReplay(&replay);
+    CloseNetClient(&client);
+    FreeProfiler(&profiler);
+    FreeParticles(&particles);
+    UnloadRenderer(&renderer);
+    DestroyWorld(world);
     CloseWindow();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,546 @@
+#include "net.h"
+#include <netdb.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+const int defaultServerPort = 27015;
+const uint32_t netMagic = 0x4e545341; // "ASTN"
+const int netVersion = 1;
+const int snapshotHeaderBits = 8 + 16 + 32 + 1 + 16 + 64 + 16 + 4 + 3 + 32 + 16;
+const int newEntityBits = 1 + 8 + 14 + 14; // plus 9 for an asteroid's radius
+const int positionBits = 14;
+const int positionOffset = 128; // quarter pixel positions cover -128..3967
+const int radiusBits = 9;
+const float viewMargin = 32; // entities this close to the view are sent too
+
+bool SequenceNewer(uint16_t a, uint16_t b)
+{
+    return (int16_t)(a - b) > 0;
+}
+
+static uint16_t QuantizePosition(float value)
+{
+    int q = (int)((value + positionOffset) * 4 + 0.5f);
+    return q < 0 ? 0 : (q >= 1 << positionBits ? (1 << positionBits) - 1 : q);
+}
+
+static float DequantizePosition(uint16_t q)
+{
+    return q / 4.0f - positionOffset;
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int PacketType(const uint8_t *data, size_t size)
+{
+    if (size < 1 || data[0] > packetDisconnect)
+        return -1;
+    return data[0];
+}
+
+size_t WriteConnectPacket(uint8_t *buffer)
+{
+    bit_writer_t writer = BitWriter(buffer, NET_MAX_PACKET);
+    WriteBits(&writer, packetConnect, 8);
+    WriteBits(&writer, netMagic, 32);
+    WriteBits(&writer, netVersion, 8);
+    return BitWriterBytes(&writer);
+}
+
+bool ReadConnectPacket(const uint8_t *data, size_t size)
+{
+    bit_reader_t reader = BitReader(data, size);
+    ReadBits(&reader, 8);
+    bool ours = ReadBits(&reader, 32) == netMagic && (int)ReadBits(&reader, 8) == netVersion;
+    return ours && !reader.overflow;
+}
+
+size_t WriteWelcomePacket(uint8_t *buffer, world_config_t config, int tickRate)
+{
+    bit_writer_t writer = BitWriter(buffer, NET_MAX_PACKET);
+    WriteBits(&writer, packetWelcome, 8);
+    WriteBits(&writer, netMagic, 32);
+    WriteBits(&writer, netVersion, 8);
+    WriteBits(&writer, config.maxBullets, 16);
+    WriteBits(&writer, config.maxAsteroids, 16);
+    WriteBits(&writer, config.seed, 32);
+    WriteBits(&writer, tickRate, 8);
+    return BitWriterBytes(&writer);
+}
+
+bool ReadWelcomePacket(const uint8_t *data, size_t size, world_config_t *config, int *tickRate)
+{
+    bit_reader_t reader = BitReader(data, size);
+    ReadBits(&reader, 8);
+    if (ReadBits(&reader, 32) != netMagic || (int)ReadBits(&reader, 8) != netVersion)
+        return false;
+    config->maxBullets = ReadBits(&reader, 16);
+    config->maxAsteroids = ReadBits(&reader, 16);
+    config->seed = ReadBits(&reader, 32);
+    *tickRate = ReadBits(&reader, 8);
+    config->tickRate = *tickRate;
+    return !reader.overflow && config->maxBullets > 0 && config->maxAsteroids > 0 && *tickRate > 0;
+}
+
+size_t WriteInputPacket(uint8_t *buffer, const net_input_t *input)
+{
+    bit_writer_t writer = BitWriter(buffer, NET_MAX_PACKET);
+    WriteBits(&writer, packetInput, 8);
+    WriteBits(&writer, input->sequence, 16);
+    WriteBits(&writer, input->input, 5);
+    WriteBits(&writer, input->hasAck, 1);
+    WriteBits(&writer, input->ack, 16);
+    WriteBits(&writer, (uint16_t)(int16_t)input->view.x, 16);
+    WriteBits(&writer, (uint16_t)(int16_t)input->view.y, 16);
+    WriteBits(&writer, (uint16_t)input->view.width, 16);
+    WriteBits(&writer, (uint16_t)input->view.height, 16);
+    return BitWriterBytes(&writer);
+}
+
+bool ReadInputPacket(const uint8_t *data, size_t size, net_input_t *input)
+{
+    bit_reader_t reader = BitReader(data, size);
+    ReadBits(&reader, 8);
+    input->sequence = ReadBits(&reader, 16);
+    input->input = ReadBits(&reader, 5);
+    input->hasAck = ReadBits(&reader, 1);
+    input->ack = ReadBits(&reader, 16);
+    input->view.x = (int16_t)ReadBits(&reader, 16);
+    input->view.y = (int16_t)ReadBits(&reader, 16);
+    input->view.width = ReadBits(&reader, 16);
+    input->view.height = ReadBits(&reader, 16);
+    return !reader.overflow;
+}
+
+size_t WriteDisconnectPacket(uint8_t *buffer)
+{
+    buffer[0] = packetDisconnect;
+    return 1;
+}
+
+static void WritePlayer(bit_writer_t *writer, const net_player_t *player)
+{
+    uint32_t bits;
+    memcpy(&bits, &player->center.x, sizeof(bits));
+    WriteBits(writer, bits, 32);
+    memcpy(&bits, &player->center.y, sizeof(bits));
+    WriteBits(writer, bits, 32);
+    WriteBits(writer, player->angle >> 16, 16);
+    WriteBits(writer, player->hp < 0 ? 0 : (player->hp > 15 ? 15 : player->hp), 4);
+    WriteBits(writer, player->invincible, 1);
+    WriteBits(writer, player->white, 1);
+    WriteBits(writer, player->dead, 1);
+    WriteBits(writer, player->score, 32);
+}
+
+static void ReadPlayer(bit_reader_t *reader, net_player_t *player)
+{
+    uint32_t bits = ReadBits(reader, 32);
+    memcpy(&player->center.x, &bits, sizeof(bits));
+    bits = ReadBits(reader, 32);
+    memcpy(&player->center.y, &bits, sizeof(bits));
+    player->angle = ReadBits(reader, 16) << 16;
+    player->hp = ReadBits(reader, 4);
+    player->invincible = ReadBits(reader, 1);
+    player->white = ReadBits(reader, 1);
+    player->dead = ReadBits(reader, 1);
+    player->score = (int)ReadBits(reader, 32);
+}
+
+// bits for one entity apart from its key, matched is the baseline entry with the same key and generation
+static int EntityBits(const net_entity_t *entity, const net_entity_t *matched)
+{
+    if (matched != NULL)
+        return 1 + SmallSignedBits(entity->x - matched->x) + SmallSignedBits(entity->y - matched->y);
+    return newEntityBits + (entity->key & NET_ASTEROID_KEY ? radiusBits : 0);
+}
+
+// walks a key sorted baseline alongside a key sorted list, returning the entry an entity can be sent against
+static const net_entity_t *MatchBaseline(const snapshot_record_t *baseline, int *cursor, const net_entity_t *entity)
+{
+    if (baseline == NULL)
+        return NULL;
+    while (*cursor < baseline->count && baseline->entities[*cursor].key < entity->key)
+        (*cursor)++;
+    if (*cursor < baseline->count && baseline->entities[*cursor].key == entity->key &&
+        baseline->entities[*cursor].generation == entity->generation)
+        return &baseline->entities[*cursor];
+    return NULL;
+}
+
+static int CompareKeys(const void *a, const void *b)
+{
+    uint32_t x = ((const net_candidate_t *)a)->entity.key;
+    uint32_t y = ((const net_candidate_t *)b)->entity.key;
+    return (x > y) - (x < y);
+}
+
+static int ComparePriorities(const void *a, const void *b)
+{
+    float x = ((const net_candidate_t *)a)->priority;
+    float y = ((const net_candidate_t *)b)->priority;
+    return (x > y) - (x < y);
+}
+
+static int AddCandidates(const entity_array_t *entities, uint32_t keyBit, Rectangle view, net_candidate_t *out)
+{
+    float centerX = view.x + view.width / 2;
+    float centerY = view.y + view.height / 2;
+    int count = 0;
+    for (int i = 0; i < entities->pool.count; i++)
+    {
+        float r = entities->radius[i] + viewMargin;
+        float x = entities->x[i];
+        float y = entities->y[i];
+        if (x + r < view.x || x - r > view.x + view.width || y + r < view.y || y - r > view.y + view.height)
+            continue;
+        handle_t handle = PoolHandle(&entities->pool, i);
+        out[count++] = (net_candidate_t){
+            .entity = {.key = keyBit | handle.id,
+                       .x = QuantizePosition(x),
+                       .y = QuantizePosition(y),
+                       .radius = (uint16_t)(entities->radius[i] * 4 + 0.5f),
+                       .generation = (uint8_t)handle.generation},
+            .priority = (x - centerX) * (x - centerX) + (y - centerY) * (y - centerY)};
+    }
+    return count;
+}
+
+void BuildSnapshotRecord(const world_t *world, Rectangle view, const snapshot_record_t *baseline,
+                         net_candidate_t *scratch, snapshot_record_t *record)
+{
+    record->player = (net_player_t){
+        .center = world->player.center,
+        .angle = world->player.angle,
+        .hp = (int)world->player.hp,
+        .invincible = world->playerIsInvincible,
+        .white = world->playerIsWhite,
+        .dead = world->state == gameStateDead,
+        .score = world->score};
+
+    int count = AddCandidates(&world->bullet, 0, view, scratch);
+    count += AddCandidates(&world->asteroid, NET_ASTEROID_KEY, view, scratch + count);
+    qsort(scratch, count, sizeof(net_candidate_t), CompareKeys);
+
+    // exact cost when everything goes in, which is the common case
+    int cursor = 0;
+    long total = 0;
+    uint32_t previousKey = (uint32_t)-1;
+    for (int i = 0; i < count; i++)
+    {
+        scratch[i].bits = EntityBits(&scratch[i].entity, MatchBaseline(baseline, &cursor, &scratch[i].entity));
+        total += VarUnsignedBits(scratch[i].entity.key - previousKey - 1) + scratch[i].bits;
+        previousKey = scratch[i].entity.key;
+    }
+
+    long budget = NET_MAX_PACKET * 8 - snapshotHeaderBits;
+    if (total > budget || count > NET_MAX_ENTITIES)
+    {
+        // keep the nearest, charging each the widest key gap since its neighbours may be dropped
+        qsort(scratch, count, sizeof(net_candidate_t), ComparePriorities);
+        long used = 0;
+        int kept = 0;
+        while (kept < count && kept < NET_MAX_ENTITIES)
+        {
+            int bits = scratch[kept].bits + VarUnsignedBits(UINT32_MAX);
+            if (used + bits > budget)
+                break;
+            used += bits;
+            kept++;
+        }
+        count = kept;
+        qsort(scratch, count, sizeof(net_candidate_t), CompareKeys);
+    }
+
+    record->count = count;
+    for (int i = 0; i < count; i++)
+        record->entities[i] = scratch[i].entity;
+}
+
+size_t WriteSnapshotPacket(uint8_t *buffer, snapshot_record_t *record, const snapshot_record_t *baseline)
+{
+    bit_writer_t writer = BitWriter(buffer, NET_MAX_PACKET);
+    WriteBits(&writer, packetSnapshot, 8);
+    WriteBits(&writer, record->sequence, 16);
+    WriteBits(&writer, record->tick, 32);
+    WriteBits(&writer, baseline != NULL, 1);
+    WriteBits(&writer, baseline != NULL ? baseline->sequence : 0, 16);
+    WritePlayer(&writer, &record->player);
+    size_t countPosition = writer.bit;
+    WriteBits(&writer, 0, 16);
+
+    int cursor = 0;
+    int written = 0;
+    uint32_t previousKey = (uint32_t)-1;
+    for (; written < record->count; written++)
+    {
+        const net_entity_t *entity = &record->entities[written];
+        const net_entity_t *matched = MatchBaseline(baseline, &cursor, entity);
+        uint32_t keyGap = entity->key - previousKey - 1;
+        if ((size_t)(VarUnsignedBits(keyGap) + EntityBits(entity, matched)) > BitsLeft(&writer))
+            break;
+        WriteVarUnsigned(&writer, keyGap);
+        WriteBits(&writer, matched != NULL, 1);
+        if (matched != NULL)
+        {
+            WriteSmallSigned(&writer, entity->x - matched->x);
+            WriteSmallSigned(&writer, entity->y - matched->y);
+        }
+        else
+        {
+            WriteBits(&writer, entity->generation, 8);
+            WriteBits(&writer, entity->x, positionBits);
+            WriteBits(&writer, entity->y, positionBits);
+            if (entity->key & NET_ASTEROID_KEY)
+                WriteBits(&writer, entity->radius, radiusBits);
+        }
+        previousKey = entity->key;
+    }
+    record->count = written;
+    PatchBits(&writer, countPosition, written, 16);
+    return BitWriterBytes(&writer);
+}
+
+bool ReadSnapshotPacket(const uint8_t *data, size_t size, const snapshot_record_t *baselines, snapshot_record_t *record)
+{
+    bit_reader_t reader = BitReader(data, size);
+    ReadBits(&reader, 8);
+    record->sequence = ReadBits(&reader, 16);
+    record->tick = ReadBits(&reader, 32);
+    bool hasBaseline = ReadBits(&reader, 1);
+    uint16_t baselineSequence = ReadBits(&reader, 16);
+    ReadPlayer(&reader, &record->player);
+    int count = ReadBits(&reader, 16);
+    if (reader.overflow || count > NET_MAX_ENTITIES)
+        return false;
+
+    const snapshot_record_t *baseline = NULL;
+    if (hasBaseline)
+    {
+        baseline = &baselines[baselineSequence % NET_BASELINES];
+        if (!baseline->valid || baseline->sequence != baselineSequence)
+            return false;
+    }
+
+    int cursor = 0;
+    uint32_t previousKey = (uint32_t)-1;
+    for (int i = 0; i < count; i++)
+    {
+        net_entity_t *entity = &record->entities[i];
+        entity->key = previousKey + 1 + ReadVarUnsigned(&reader);
+        if (ReadBits(&reader, 1))
+        {
+            if (baseline == NULL)
+                return false;
+            while (cursor < baseline->count && baseline->entities[cursor].key < entity->key)
+                cursor++;
+            if (cursor == baseline->count || baseline->entities[cursor].key != entity->key)
+                return false;
+            const net_entity_t *matched = &baseline->entities[cursor];
+            entity->generation = matched->generation;
+            entity->radius = matched->radius;
+            entity->x = matched->x + ReadSmallSigned(&reader);
+            entity->y = matched->y + ReadSmallSigned(&reader);
+        }
+        else
+        {
+            entity->generation = ReadBits(&reader, 8);
+            entity->x = ReadBits(&reader, positionBits);
+            entity->y = ReadBits(&reader, positionBits);
+            entity->radius = entity->key & NET_ASTEROID_KEY ? ReadBits(&reader, radiusBits) : (uint16_t)(bulletSize * 4);
+        }
+        previousKey = entity->key;
+    }
+    record->count = count;
+    record->valid = !reader.overflow;
+    return record->valid;
+}
+
+// the handle the server took the entity from, its generation cut to the bits that were sent
+static handle_t EntityHandle(const net_entity_t *entity)
+{
+    return (handle_t){.id = entity->key & (NET_ASTEROID_KEY - 1), .generation = entity->generation};
+}
+
+// rebuilds the pool so the handles the server sent resolve on the client too
+static void ApplyEntities(entity_array_t *entities, const net_entity_t *list, int count)
+{
+    pool_t *pool = &entities->pool;
+    for (int i = 0; i < pool->count; i++)
+        pool->slotOf[pool->idOf[i]] = -1;
+    int slot = 0;
+    for (int i = 0; i < count && slot < entities->capacity; i++)
+    {
+        handle_t handle = EntityHandle(&list[i]);
+        if (handle.id >= pool->capacity)
+            continue;
+        pool->idOf[slot] = handle.id;
+        pool->slotOf[handle.id] = slot;
+        pool->generation[handle.id] = handle.generation;
+        entities->x[slot] = DequantizePosition(list[i].x);
+        entities->y[slot] = DequantizePosition(list[i].y);
+        entities->previousX[slot] = entities->x[slot]; // snapshots are drawn as they arrive
+        entities->previousY[slot] = entities->y[slot];
+        entities->vx[slot] = 0;
+        entities->vy[slot] = 0;
+        entities->radius[slot] = list[i].radius / 4.0f;
+        entities->alive[slot] = -1;
+        slot++;
+    }
+    pool->count = slot;
+}
+
+void ApplySnapshotRecord(world_t *world, const snapshot_record_t *record)
+{
+    const net_player_t *player = &record->player;
+    world->player.center = player->center;
+    world->player.angle = player->angle;
+    world->player.hp = player->hp;
+    world->playerIsInvincible = player->invincible;
+    world->playerIsWhite = player->white;
+    world->state = player->dead ? gameStateDead : gameStatePlaying;
+    world->score = player->score;
+    CalculatePlayerPosition(world);
+    world->previousPlayerCenter = world->player.center;
+    world->previousTriangleA = world->triangleA;
+    world->previousTriangleB = world->triangleB;
+    world->previousTriangleC = world->triangleC;
+
+    // bullets sort before asteroids
+    int bullets = 0;
+    while (bullets < record->count && !(record->entities[bullets].key & NET_ASTEROID_KEY))
+        bullets++;
+    ApplyEntities(&world->bullet, record->entities, bullets);
+    ApplyEntities(&world->asteroid, record->entities + bullets, record->count - bullets);
+
+    // outlines are not sent, they follow from id and generation. rebuilding them is cheap next to decoding
+    const entity_array_t *asteroid = &world->asteroid;
+    for (int i = 0; i < asteroid->pool.count; i++)
+    {
+        handle_t handle = PoolHandle(&asteroid->pool, i);
+        MakeAsteroidShape(&world->asteroidShape[handle.id * ASTEROID_VERTICES], AsteroidShapeSeed(handle),
+                          asteroid->radius[i]);
+    }
+}
+
+bool OpenNetClient(net_client_t *client, const char *address)
+{
+    *client = (net_client_t){.socket = -1};
+    char host[256];
+    const char *colon = strrchr(address, ':');
+    if (colon == NULL || colon - address >= (long)sizeof(host))
+        return false;
+    memcpy(host, address, colon - address);
+    host[colon - address] = '\0';
+
+    struct addrinfo hints = {.ai_family = AF_INET, .ai_socktype = SOCK_DGRAM};
+    struct addrinfo *found;
+    if (getaddrinfo(host, colon + 1, &hints, &found) != 0)
+        return false;
+    client->socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    bool connected = client->socket != -1 && connect(client->socket, found->ai_addr, found->ai_addrlen) == 0;
+    freeaddrinfo(found);
+    client->received = calloc(NET_BASELINES, sizeof(snapshot_record_t));
+    if (!connected || client->received == NULL)
+    {
+        CloseNetClient(client);
+        return false;
+    }
+    return true;
+}
+
+void CloseNetClient(net_client_t *client)
+{
+    if (client->socket != -1)
+    {
+        uint8_t packet[NET_MAX_PACKET];
+        send(client->socket, packet, WriteDisconnectPacket(packet), 0);
+        close(client->socket);
+    }
+    free(client->received);
+    *client = (net_client_t){.socket = -1};
+}
+
+bool ConnectNetClient(net_client_t *client, double timeout)
+{
+    uint8_t packet[NET_MAX_PACKET];
+    double deadline = Now() + timeout;
+    while (Now() < deadline)
+    {
+        size_t size = WriteConnectPacket(packet);
+        send(client->socket, packet, size, 0);
+        client->bytesOut += size;
+
+        struct pollfd wait = {.fd = client->socket, .events = POLLIN};
+        if (poll(&wait, 1, 250) <= 0)
+            continue;
+        ssize_t received;
+        while ((received = recv(client->socket, packet, sizeof(packet), 0)) > 0)
+        {
+            client->bytesIn += received;
+            if (PacketType(packet, received) == packetWelcome &&
+                ReadWelcomePacket(packet, received, &client->config, &client->tickRate))
+                return true;
+        }
+    }
+    return false;
+}
+
+void SendNetInput(net_client_t *client, unsigned int input, Rectangle view)
+{
+    net_input_t message = {.sequence = client->inputSequence++,
+                           .input = input,
+                           .hasAck = client->hasLatest,
+                           .ack = client->latest,
+                           .view = view};
+    uint8_t packet[NET_MAX_PACKET];
+    size_t size = WriteInputPacket(packet, &message);
+    if (send(client->socket, packet, size, 0) > 0)
+        client->bytesOut += size;
+}
+
+int HandleNetClientPacket(net_client_t *client, const uint8_t *data, size_t size)
+{
+    client->bytesIn += size;
+    if (PacketType(data, size) != packetSnapshot || size < 3)
+        return 0;
+    uint16_t sequence = data[1] | data[2] << 8;
+    if (client->hasLatest && !SequenceNewer(sequence, client->latest))
+        return 0; // late or duplicated, the newer one already covers it
+
+    snapshot_record_t *slot = &client->received[sequence % NET_BASELINES];
+    slot->valid = false;
+    if (!ReadSnapshotPacket(data, size, client->received, slot))
+    {
+        client->rejected++;
+        return 0;
+    }
+    client->hasLatest = true;
+    client->latest = sequence;
+    client->snapshots++;
+    return 1;
+}
+
+int PollNetClient(net_client_t *client)
+{
+    uint8_t packet[NET_MAX_PACKET];
+    ssize_t received;
+    int snapshots = 0;
+    while ((received = recv(client->socket, packet, sizeof(packet), 0)) > 0)
+        snapshots += HandleNetClientPacket(client, packet, received);
+    return snapshots;
+}
+
+const snapshot_record_t *LatestSnapshot(const net_client_t *client)
+{
+    return client->hasLatest ? &client->received[client->latest % NET_BASELINES] : NULL;
+}
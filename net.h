@@ -0,0 +1,127 @@
+#ifndef NET_H
+#define NET_H
+
+#include "game.h"
+#include "bitpack.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NET_MAX_PACKET 1200  // stays under a typical mtu, snapshots are cut down to fit
+#define NET_MAX_ENTITIES 512 // per snapshot
+#define NET_BASELINES 16     // snapshots both ends keep to delta against, by sequence % NET_BASELINES
+#define NET_ASTEROID_KEY (1u << 16) // entity keys are the pool id, with this bit set for asteroids
+
+extern const int defaultServerPort;
+
+typedef enum packet_type_e
+{
+    packetConnect,
+    packetWelcome,
+    packetInput,
+    packetSnapshot,
+    packetDisconnect
+} packet_type_e;
+
+// an entity as it goes over the wire, positions in quarter pixels
+typedef struct net_entity_t
+{
+    uint32_t key;
+    uint16_t x;
+    uint16_t y;
+    uint16_t radius;
+    uint8_t generation; // low bits of the pool handle's generation, enough for the client's label cache
+} net_entity_t;
+
+typedef struct net_player_t
+{
+    Vector2 center;
+    angle_t angle;
+    int hp;
+    bool invincible;
+    bool white;
+    bool dead;
+    int score;
+} net_player_t;
+
+// what one snapshot told the client, kept on both ends so the next one can be sent as a delta
+typedef struct snapshot_record_t
+{
+    bool valid;
+    uint16_t sequence;
+    uint32_t tick;
+    net_player_t player;
+    int count;
+    net_entity_t entities[NET_MAX_ENTITIES]; // sorted by key
+} snapshot_record_t;
+
+// server scratch for picking entities, one per entity the world can hold
+typedef struct net_candidate_t
+{
+    net_entity_t entity;
+    float priority; // squared distance to the view's centre
+    int bits;       // cost against the baseline, leaving out the key
+} net_candidate_t;
+
+typedef struct net_input_t
+{
+    uint16_t sequence;
+    unsigned int input; // input_e bits
+    bool hasAck;
+    uint16_t ack; // newest snapshot the client has
+    Rectangle view; // world area the client draws, only entities near it are sent
+} net_input_t;
+
+// true when a is after b, allowing for wraparound
+bool SequenceNewer(uint16_t a, uint16_t b);
+
+// packets, each Write returns the bytes used
+int PacketType(const uint8_t *data, size_t size); // -1 if it is not one of ours
+size_t WriteConnectPacket(uint8_t *buffer);
+bool ReadConnectPacket(const uint8_t *data, size_t size);
+size_t WriteWelcomePacket(uint8_t *buffer, world_config_t config, int tickRate);
+bool ReadWelcomePacket(const uint8_t *data, size_t size, world_config_t *config, int *tickRate);
+size_t WriteInputPacket(uint8_t *buffer, const net_input_t *input);
+bool ReadInputPacket(const uint8_t *data, size_t size, net_input_t *input);
+size_t WriteDisconnectPacket(uint8_t *buffer);
+
+// server: the player and every entity near view, nearest to its centre first once they would not all fit a packet
+void BuildSnapshotRecord(const world_t *world, Rectangle view, const snapshot_record_t *baseline,
+                         net_candidate_t *scratch, snapshot_record_t *record);
+// baseline may be NULL for a full snapshot. trims record to what fit so it matches what the client will have
+size_t WriteSnapshotPacket(uint8_t *buffer, snapshot_record_t *record, const snapshot_record_t *baseline);
+
+// client: decodes against the baseline it names from baselines, false if it is malformed or that baseline is gone
+bool ReadSnapshotPacket(const uint8_t *data, size_t size, const snapshot_record_t *baselines, snapshot_record_t *record);
+// overwrites the player and entity lanes of a world used only for drawing
+void ApplySnapshotRecord(world_t *world, const snapshot_record_t *record);
+
+// thin client over a connected udp socket
+typedef struct net_client_t
+{
+    int socket;
+    world_config_t config;
+    int tickRate;
+    uint16_t inputSequence;
+    bool hasLatest;
+    uint16_t latest;
+    snapshot_record_t *received; // NET_BASELINES
+    long bytesIn;
+    long bytesOut;
+    long snapshots;
+    long rejected; // malformed or missing their baseline
+} net_client_t;
+
+// address is host:port
+bool OpenNetClient(net_client_t *client, const char *address);
+void CloseNetClient(net_client_t *client);
+// sends connect until the welcome arrives, false on timeout
+bool ConnectNetClient(net_client_t *client, double timeout);
+void SendNetInput(net_client_t *client, unsigned int input, Rectangle view);
+// reads everything waiting without blocking, returns how many new snapshots were decoded
+int PollNetClient(net_client_t *client);
+// handles one datagram the caller already read, for loops that drive many clients. returns 1 for a new snapshot
+int HandleNetClientPacket(net_client_t *client, const uint8_t *data, size_t size);
+const snapshot_record_t *LatestSnapshot(const net_client_t *client); // NULL before the first
+
+#endif
@@ -0,0 +1,184 @@
+#include "particles.h"
+#include "entity.h"
+#include "kernels.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+const float particleDrag = 0.2f;     // velocity left after a second
+const float particleBackoff = 0.5f;  // spawn scale kept after a frame over budget
+const float particleRecovery = 0.02f; // spawn scale regained per frame under budget
+const int thrustParticles = 2;       // per tick while W is held
+
+#define PARTICLE_DRAWS 64 // particles whose numbers are drawn in one go
+
+// every lane capacity long in one block, the float lanes first and the colors last. a NULL base only measures
+static size_t PlaceParticles(particle_system_t *particles, unsigned char *base)
+{
+    int capacity = particles->capacity;
+    arena_t arena = {.base = base};
+    particles->x = ArenaTake(&arena, capacity * sizeof(float));
+    particles->y = ArenaTake(&arena, capacity * sizeof(float));
+    particles->vx = ArenaTake(&arena, capacity * sizeof(float));
+    particles->vy = ArenaTake(&arena, capacity * sizeof(float));
+    particles->life = ArenaTake(&arena, capacity * sizeof(float));
+    particles->fade = ArenaTake(&arena, capacity * sizeof(float));
+    particles->size = ArenaTake(&arena, capacity * sizeof(float));
+    particles->color = ArenaTake(&arena, capacity * sizeof(Color));
+    return arena.used;
+}
+
+bool InitParticles(particle_system_t *particles, int capacity, float frameBudget)
+{
+    capacity = (capacity + ENTITY_LANES - 1) / ENTITY_LANES * ENTITY_LANES; // the kernel runs whole lanes
+    *particles = (particle_system_t){.capacity = capacity, .frameBudget = frameBudget, .spawnScale = 1};
+    size_t bytes = PlaceParticles(particles, NULL);
+    void *memory = aligned_alloc(ARENA_ALIGN, bytes > 0 ? bytes : ARENA_ALIGN);
+    if (memory == NULL)
+        return false;
+    PlaceParticles(particles, memory);
+    return true;
+}
+
+void FreeParticles(particle_system_t *particles)
+{
+    free(particles->x);
+    particles->x = NULL;
+    particles->capacity = 0;
+    particles->count = 0;
+}
+
+void SpawnParticleBurst(particle_system_t *particles, particle_burst_t burst)
+{
+    particles->spawnCarry += burst.count * particles->spawnScale;
+    int count = (int)particles->spawnCarry;
+    particles->spawnCarry -= count;
+    int room = particles->capacity - particles->count;
+    if (count > room)
+        count = room;
+
+    // effects have a stream of their own, so they never shift the world's numbers
+    random_key_t key = RandomKey(0, randomStreamParticles);
+    random_block_t random[PARTICLE_DRAWS];
+    for (int n = 0; n < count; n++)
+    {
+        int r = n % PARTICLE_DRAWS;
+        if (r == 0)
+            FillRandomBlocks(key, particles->serial + n, 0, 0, random,
+                             count - n < PARTICLE_DRAWS ? count - n : PARTICLE_DRAWS);
+        int i = particles->count++;
+        uint64_t offset = (uint64_t)random[r].word[0] * ((uint64_t)burst.spread * 2) >> 32;
+        angle_t angle = burst.direction - burst.spread + (angle_t)offset;
+        float speed = burst.minSpeed + (burst.maxSpeed - burst.minSpeed) * RandomUnit(random[r].word[1]);
+        float lifetime = burst.lifetime * (0.5f + RandomUnit(random[r].word[2])); // 0.5 to 1.5 of the burst's
+        particles->x[i] = burst.position.x;
+        particles->y[i] = burst.position.y;
+        particles->vx[i] = burst.velocity.x + speed * AngleCos(angle);
+        particles->vy[i] = burst.velocity.y + speed * AngleSin(angle);
+        particles->life[i] = lifetime;
+        particles->fade[i] = 1 / lifetime;
+        particles->size[i] = burst.size;
+        particles->color[i] = burst.color;
+    }
+    particles->serial += count;
+    particles->requested += burst.count;
+    particles->spawned += count;
+}
+
+void SpawnWorldEffects(particle_system_t *particles, const world_t *world)
+{
+    float perSecond = (float)world->config.tickRate; // event velocities are per tick
+    for (int e = 0; e < world->eventCount; e++)
+    {
+        world_event_t event = world->events[e];
+        Vector2 drift = {event.velocity.x * perSecond, event.velocity.y * perSecond};
+        particle_burst_t debris = {.position = event.position, .velocity = drift, .spread = HALF_TURN,
+                                   .minSpeed = 40, .maxSpeed = 220, .lifetime = 0.6f, .size = 2, .color = BROWN,
+                                   .count = (int)(event.size / 2)};
+        switch (event.type)
+        {
+        case worldEventAsteroidDestroyed:
+            SpawnParticleBurst(particles, debris);
+            debris.color = ORANGE;
+            debris.count /= 2;
+            debris.maxSpeed = 120;
+            debris.lifetime = 0.3f;
+            debris.size = 3;
+            SpawnParticleBurst(particles, debris);
+            break;
+        case worldEventAsteroidSplit:
+            // the halves carry on, so only chips fly off
+            debris.count /= 3;
+            SpawnParticleBurst(particles, debris);
+            break;
+        case worldEventPlayerHit:
+            debris.color = RED;
+            debris.count = 40;
+            debris.maxSpeed = 320;
+            SpawnParticleBurst(particles, debris);
+            debris.color = WHITE;
+            debris.count = 15;
+            debris.lifetime = 0.3f;
+            SpawnParticleBurst(particles, debris);
+            break;
+        case worldEventThrust:
+        {
+            // out of the back of the ship, a narrow cone against the heading
+            Vector2 back = PolarOffset(event.position, event.size / 3, event.angle + HALF_TURN);
+            particle_burst_t exhaust = {.position = back, .velocity = drift, .direction = event.angle + HALF_TURN,
+                                        .spread = QUARTER_TURN / 6, .minSpeed = 120, .maxSpeed = 260,
+                                        .lifetime = 0.25f, .size = 3, .color = ORANGE, .count = thrustParticles};
+            SpawnParticleBurst(particles, exhaust);
+            exhaust.color = YELLOW;
+            exhaust.size = 2;
+            exhaust.count = thrustParticles / 2;
+            SpawnParticleBurst(particles, exhaust);
+            break;
+        }
+        }
+    }
+}
+
+void UpdateParticles(particle_system_t *particles, float dt)
+{
+    float damp = powf(particleDrag, dt);
+    int count = particles->count;
+    // lanes in locals, through the struct every store would make the compiler reload them
+    float *restrict x = particles->x, *restrict y = particles->y;
+    float *restrict vx = particles->vx, *restrict vy = particles->vy;
+    float *restrict life = particles->life, *restrict fade = particles->fade, *restrict size = particles->size;
+    Color *restrict color = particles->color;
+    AgeParticles(x, y, vx, vy, life, dt, damp, (count + ENTITY_LANES - 1) / ENTITY_LANES * ENTITY_LANES);
+
+    // every particle is copied down and the write position only advances past live ones, so there is no branch
+    // to mispredict however the dead ones are scattered
+    int kept = 0;
+    for (int i = 0; i < count; i++)
+    {
+        float left = life[i];
+        x[kept] = x[i];
+        y[kept] = y[i];
+        vx[kept] = vx[i];
+        vy[kept] = vy[i];
+        life[kept] = left;
+        fade[kept] = fade[i];
+        size[kept] = size[i];
+        color[kept] = color[i];
+        kept += left > 0;
+    }
+    particles->count = kept;
+}
+
+void AdjustParticleBudget(particle_system_t *particles, float frameSeconds)
+{
+    if (frameSeconds > particles->frameBudget)
+        particles->spawnScale *= particleBackoff;
+    else
+        particles->spawnScale = fminf(1, particles->spawnScale + particleRecovery);
+}
+
+void ResetParticleStats(particle_system_t *particles)
+{
+    particles->requested = 0;
+    particles->spawned = 0;
+}
@@ -0,0 +1,60 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "raylib.h"
+#include "game.h"
+#include <stdbool.h>
+
+// cosmetic particles, stored as structure of arrays in one fixed allocation. they live outside the world, so
+// replays, rollback and hashes never see them. positions are in world coordinates, velocities per second
+typedef struct particle_system_t
+{
+    int capacity;
+    int count; // live particles are packed into 0..count-1
+    float *x;
+    float *y;
+    float *vx;
+    float *vy;
+    float *life; // seconds left
+    float *fade; // 1 / lifetime, life * fade is the opacity
+    float *size; // radius
+    Color *color;
+
+    float frameBudget; // seconds of frame work above which spawning backs off
+    float spawnScale;  // 0..1 of every burst that is actually spawned
+    float spawnCarry;  // fractions of a particle owed to the next burst
+    uint32_t serial;   // particles ever spawned, each one's numbers are drawn at its own
+    int requested;     // by bursts since the last ResetParticleStats
+    int spawned;       // of those, the rest was cut by the budget or did not fit
+} particle_system_t;
+
+// count particles fanned out around direction by up to spread either side, all starting at position
+typedef struct particle_burst_t
+{
+    Vector2 position;
+    Vector2 velocity; // added to every particle, per second
+    angle_t direction;
+    angle_t spread; // HALF_TURN sends them every way
+    float minSpeed; // per second
+    float maxSpeed;
+    float lifetime; // seconds
+    float size;
+    Color color;
+    int count;
+} particle_burst_t;
+
+bool InitParticles(particle_system_t *particles, int capacity, float frameBudget);
+void FreeParticles(particle_system_t *particles);
+
+// spawns as much of the burst as the budget and the free storage allow
+void SpawnParticleBurst(particle_system_t *particles, particle_burst_t burst);
+// turns the events of the world's last tick into bursts
+void SpawnWorldEffects(particle_system_t *particles, const world_t *world);
+// moves and ages every particle by dt seconds and drops the ones that ran out
+void UpdateParticles(particle_system_t *particles, float dt);
+// feeds back how long the last frame's work took. over frameBudget halves the spawn rate, under it recovers
+void AdjustParticleBudget(particle_system_t *particles, float frameSeconds);
+// starts a new count of requested and spawned particles, what the budget cut is the difference
+void ResetParticleStats(particle_system_t *particles);
+
+#endif
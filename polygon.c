@@ -0,0 +1,90 @@
+#include "polygon.h"
+#include <math.h>
+
+static float Dot(Vector2 a, Vector2 b)
+{
+    return a.x * b.x + a.y * b.y;
+}
+
+static float Cross(Vector2 origin, Vector2 a, Vector2 b)
+{
+    return (a.x - origin.x) * (b.y - origin.y) - (a.y - origin.y) * (b.x - origin.x);
+}
+
+static void Project(const Vector2 *polygon, int count, Vector2 axis, float *min, float *max)
+{
+    *min = *max = Dot(polygon[0], axis);
+    for (int i = 1; i < count; i++)
+    {
+        float d = Dot(polygon[i], axis);
+        if (d < *min)
+            *min = d;
+        if (d > *max)
+            *max = d;
+    }
+}
+
+// edge normals of a are the candidate axes, they do not need to be unit length for a yes/no answer
+static bool SeparatedByEdgesOf(const Vector2 *a, int aCount, const Vector2 *b, int bCount)
+{
+    for (int i = 0; i < aCount; i++)
+    {
+        Vector2 from = a[i];
+        Vector2 to = a[(i + 1) % aCount];
+        Vector2 axis = {from.y - to.y, to.x - from.x};
+        float aMin, aMax, bMin, bMax;
+        Project(a, aCount, axis, &aMin, &aMax);
+        Project(b, bCount, axis, &bMin, &bMax);
+        if (aMax < bMin || bMax < aMin)
+            return true;
+    }
+    return false;
+}
+
+bool ConvexOverlap(const Vector2 *a, int aCount, const Vector2 *b, int bCount)
+{
+    return !SeparatedByEdgesOf(a, aCount, b, bCount) && !SeparatedByEdgesOf(b, bCount, a, aCount);
+}
+
+bool CircleConvexOverlap(Vector2 center, float radius, const Vector2 *polygon, int count)
+{
+    // the polygon's edge normals plus the axis towards its nearest vertex cover every way a circle can be apart
+    int nearest = 0;
+    float nearestDistance = INFINITY;
+    for (int i = 0; i <= count; i++)
+    {
+        Vector2 axis;
+        if (i < count)
+        {
+            Vector2 from = polygon[i];
+            Vector2 to = polygon[(i + 1) % count];
+            axis = (Vector2){from.y - to.y, to.x - from.x};
+            Vector2 offset = {from.x - center.x, from.y - center.y};
+            float distance = Dot(offset, offset);
+            if (distance < nearestDistance)
+            {
+                nearestDistance = distance;
+                nearest = i;
+            }
+        }
+        else
+        {
+            axis = (Vector2){polygon[nearest].x - center.x, polygon[nearest].y - center.y};
+        }
+        float length = sqrtf(Dot(axis, axis));
+        if (length == 0)
+            continue;
+        float min, max;
+        Project(polygon, count, axis, &min, &max);
+        float c = Dot(center, axis);
+        float reach = radius * length;
+        if (max < c - reach || c + reach < min)
+            return false;
+    }
+    return true;
+}
+
+bool SegmentsCross(Vector2 a0, Vector2 a1, Vector2 b0, Vector2 b1)
+{
+    return (Cross(b0, b1, a0) < 0) != (Cross(b0, b1, a1) < 0) && (Cross(a0, a1, b0) < 0) != (Cross(a0, a1, b1) < 0);
+}
@@ -0,0 +1,15 @@
+#ifndef POLYGON_H
+#define POLYGON_H
+
+#include "raylib.h"
+#include <stdbool.h>
+
+// separating axis tests for small convex polygons, vertices in either winding. touching counts as overlapping.
+// only plain float math, so results are the same on every build compiled with -ffp-contract=off
+
+bool ConvexOverlap(const Vector2 *a, int aCount, const Vector2 *b, int bCount);
+bool CircleConvexOverlap(Vector2 center, float radius, const Vector2 *polygon, int count);
+// true when segment a0-a1 properly crosses segment b0-b1
+bool SegmentsCross(Vector2 a0, Vector2 a1, Vector2 b0, Vector2 b1);
+
+#endif
@@ -0,0 +1,64 @@
+#include "pool.h"
+
+void PlacePool(pool_t *pool, int capacity, arena_t *arena)
+{
+    pool->capacity = capacity;
+    pool->slotOf = ArenaTake(arena, capacity * sizeof(int));
+    pool->idOf = ArenaTake(arena, capacity * sizeof(int));
+    pool->generation = ArenaTake(arena, capacity * sizeof(unsigned int));
+    pool->freeIds = ArenaTake(arena, capacity * sizeof(int));
+}
+
+void ClearPool(pool_t *pool)
+{
+    for (int id = 0; id < pool->capacity; id++)
+    {
+        if (pool->count > 0 && pool->slotOf[id] != -1)
+            pool->generation[id]++;
+        pool->slotOf[id] = -1;
+        // stacked in reverse so ids are handed out from 0 upwards
+        pool->freeIds[id] = pool->capacity - 1 - id;
+    }
+    pool->freeCount = pool->capacity;
+    pool->count = 0;
+}
+
+int PoolAllocate(pool_t *pool)
+{
+    if (pool->freeCount == 0)
+        return -1;
+    int id = pool->freeIds[--pool->freeCount];
+    int slot = pool->count++;
+    pool->slotOf[id] = slot;
+    pool->idOf[slot] = id;
+    return slot;
+}
+
+int PoolRemove(pool_t *pool, int slot)
+{
+    int id = pool->idOf[slot];
+    pool->slotOf[id] = -1;
+    pool->generation[id]++;
+    pool->freeIds[pool->freeCount++] = id;
+
+    int last = --pool->count;
+    if (slot == last)
+        return -1;
+    int movedId = pool->idOf[last];
+    pool->idOf[slot] = movedId;
+    pool->slotOf[movedId] = slot;
+    return last;
+}
+
+handle_t PoolHandle(const pool_t *pool, int slot)
+{
+    int id = pool->idOf[slot];
+    return (handle_t){.id = id, .generation = pool->generation[id]};
+}
+
+int PoolResolve(const pool_t *pool, handle_t handle)
+{
+    if (handle.id < 0 || handle.id >= pool->capacity || pool->generation[handle.id] != handle.generation)
+        return -1;
+    return pool->slotOf[handle.id];
+}
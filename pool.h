@@ -0,0 +1,45 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include "arena.h"
+#include <stdbool.h>
+
+// stable reference to a pooled object. the generation changes every time the id is
+// freed, so a handle kept past its object's death no longer resolves
+typedef struct handle_t
+{
+    int id;
+    unsigned int generation;
+} handle_t;
+
+// free list of ids mapped onto a packed range of slots. live objects always occupy
+// slots 0..count-1; removing one moves the last slot into the hole, so loops never
+// visit dead slots. the pool only does the bookkeeping, the owner moves its own data
+typedef struct pool_t
+{
+    int capacity;
+    int count;
+    int *slotOf;              // id -> slot, -1 while the id is free
+    int *idOf;                // slot -> id
+    unsigned int *generation; // per id
+    int *freeIds;             // stack of unused ids
+    int freeCount;
+} pool_t;
+
+// points the pool's arrays into the arena without touching count or the free list,
+// so it also re-attaches a pool whose arrays were copied in from a snapshot. ClearPool before first use
+void PlacePool(pool_t *pool, int capacity, arena_t *arena);
+// forgets every object, generations keep counting so old handles stay stale
+void ClearPool(pool_t *pool);
+
+// slot of the new object, or -1 when the pool is full. new objects always take slot count-1
+int PoolAllocate(pool_t *pool);
+// frees the object in slot. returns the slot whose object was moved into it, or -1 if
+// slot was the last one. the caller copies its data from that slot to keep it packed
+int PoolRemove(pool_t *pool, int slot);
+
+handle_t PoolHandle(const pool_t *pool, int slot);
+// slot the handle currently points at, or -1 if its object has been freed
+int PoolResolve(const pool_t *pool, handle_t handle);
+
+#endif
@@ -0,0 +1,145 @@
+#include "profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+const char *profilePhaseNames[phaseCount + 1] = {"input", "spawn", "integration", "collision", "particles",
+                                                "render list", "draw", "capture", "frame"};
+const int64_t spikeThreshold = 16600000; // ns, one 60 hz frame
+const int maxTraceEvents = 1 << 20;      // about 24 MB, later events are dropped
+
+static int64_t NowNanoseconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void AddTraceEvent(profiler_t *profiler, int phase, int64_t start, int64_t duration)
+{
+    if (profiler->events == NULL || profiler->eventCount >= profiler->eventCapacity)
+        return;
+    profiler->events[profiler->eventCount++] = (trace_event_t){phase, start - profiler->origin, duration};
+}
+
+bool InitProfiler(profiler_t *profiler, bool trace)
+{
+    *profiler = (profiler_t){.origin = NowNanoseconds(), .spikeFrame = -1};
+    if (trace)
+    {
+        profiler->events = malloc(maxTraceEvents * sizeof(trace_event_t));
+        if (profiler->events == NULL)
+            return false;
+        profiler->eventCapacity = maxTraceEvents;
+    }
+    return true;
+}
+
+void FreeProfiler(profiler_t *profiler)
+{
+    free(profiler->events);
+    *profiler = (profiler_t){0};
+}
+
+void ProfileBeginFrame(profiler_t *profiler)
+{
+    if (profiler == NULL)
+        return;
+    memset(profiler->current, 0, sizeof(profiler->current));
+    profiler->frameStart = NowNanoseconds();
+}
+
+void ProfileEndFrame(profiler_t *profiler)
+{
+    if (profiler == NULL)
+        return;
+    int64_t now = NowNanoseconds();
+    int64_t frameTime = now - profiler->frameStart;
+    AddTraceEvent(profiler, phaseFrame, profiler->frameStart, frameTime);
+
+    int slot = profiler->historyIndex;
+    for (int phase = 0; phase < phaseCount; phase++)
+        profiler->history[phase][slot] = profiler->current[phase];
+    profiler->history[phaseFrame][slot] = frameTime;
+    profiler->historyIndex = (slot + 1) % PROFILE_FRAMES;
+
+    if (frameTime > spikeThreshold)
+    {
+        int worst = 0;
+        for (int phase = 1; phase < phaseCount; phase++)
+            if (profiler->current[phase] > profiler->current[worst])
+                worst = phase;
+        profiler->spikeFrame = profiler->frames;
+        profiler->spikeTime = frameTime;
+        profiler->spikePhase = worst;
+    }
+    profiler->frames++;
+}
+
+void ProfileBegin(profiler_t *profiler, profile_phase_e phase)
+{
+    if (profiler == NULL)
+        return;
+    profiler->phaseStart[phase] = NowNanoseconds();
+}
+
+void ProfileEnd(profiler_t *profiler, profile_phase_e phase)
+{
+    if (profiler == NULL)
+        return;
+    int64_t duration = NowNanoseconds() - profiler->phaseStart[phase];
+    profiler->current[phase] += duration;
+    AddTraceEvent(profiler, phase, profiler->phaseStart[phase], duration);
+}
+
+static int CompareTimes(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+profile_stats_t GetProfileStats(const profiler_t *profiler, profile_phase_e phase)
+{
+    int count = profiler->frames < PROFILE_FRAMES ? (int)profiler->frames : PROFILE_FRAMES;
+    if (count == 0)
+        return (profile_stats_t){0};
+    int64_t sorted[PROFILE_FRAMES];
+    memcpy(sorted, profiler->history[phase], count * sizeof(int64_t));
+    qsort(sorted, count, sizeof(int64_t), CompareTimes);
+    return (profile_stats_t){
+        .p50 = sorted[count / 2] / 1e6,
+        .p99 = sorted[(count * 99) / 100] / 1e6,
+        .max = sorted[count - 1] / 1e6};
+}
+
+int GetFrameTimes(const profiler_t *profiler, float *times, int max)
+{
+    int count = profiler->frames < PROFILE_FRAMES ? (int)profiler->frames : PROFILE_FRAMES;
+    if (count > max)
+        count = max;
+    for (int i = 0; i < count; i++)
+    {
+        int slot = (profiler->historyIndex - 1 - i + PROFILE_FRAMES) % PROFILE_FRAMES;
+        times[i] = profiler->history[phaseFrame][slot] / 1e6f;
+    }
+    return count;
+}
+
+bool WriteChromeTrace(const profiler_t *profiler, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+        return false;
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (int i = 0; i < profiler->eventCount; i++)
+    {
+        trace_event_t event = profiler->events[i];
+        // one row, every phase runs between its frame's begin and end so the viewer nests it under the frame
+        fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}\n",
+                i == 0 ? "" : ",", profilePhaseNames[event.phase], event.start / 1e3, event.duration / 1e3);
+    }
+    fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+    return fclose(file) == 0;
+}
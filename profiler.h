@@ -0,0 +1,79 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PROFILE_FRAMES 240 // frames of history kept per phase
+
+typedef enum profile_phase_e
+{
+    phaseInput,
+    phaseSpawn,
+    phaseIntegration,
+    phaseCollision,
+    phaseParticles,
+    phaseRenderList,
+    phaseDraw,
+    phaseCapture,
+    phaseCount,
+    phaseFrame = phaseCount // ProfileBeginFrame to ProfileEndFrame, only valid for GetProfileStats
+} profile_phase_e;
+
+extern const char *profilePhaseNames[phaseCount + 1];
+
+typedef struct trace_event_t
+{
+    int phase; // profile_phase_e, phaseFrame for the frame itself
+    int64_t start;    // ns since the profiler started
+    int64_t duration; // ns
+} trace_event_t;
+
+typedef struct profile_stats_t
+{
+    double p50; // ms
+    double p99;
+    double max;
+} profile_stats_t;
+
+// monotonic clock timers around each phase of a frame. a phase may be entered several
+// times per frame, its time adds up. every call accepts a NULL profiler and does nothing
+typedef struct profiler_t
+{
+    int64_t origin;
+    int64_t frameStart;
+    int64_t phaseStart[phaseCount];
+    int64_t current[phaseCount]; // this frame so far
+
+    int64_t history[phaseCount + 1][PROFILE_FRAMES]; // ring per phase, last row is the frame
+    int historyIndex;                                // slot the next frame goes in
+    long frames;
+
+    // last frame over the spike threshold and the phase that took longest in it
+    long spikeFrame;
+    int64_t spikeTime;
+    profile_phase_e spikePhase;
+
+    trace_event_t *events; // only kept when tracing, capped at eventCapacity
+    int eventCount;
+    int eventCapacity;
+} profiler_t;
+
+bool InitProfiler(profiler_t *profiler, bool trace);
+void FreeProfiler(profiler_t *profiler);
+
+// bracket the frame's work, not the waits that pace it or the swap, or every paced frame would count as a spike
+void ProfileBeginFrame(profiler_t *profiler);
+void ProfileEndFrame(profiler_t *profiler);
+void ProfileBegin(profiler_t *profiler, profile_phase_e phase);
+void ProfileEnd(profiler_t *profiler, profile_phase_e phase);
+
+// over the frames in the ring, phaseFrame for whole frames
+profile_stats_t GetProfileStats(const profiler_t *profiler, profile_phase_e phase);
+// most recent first, in ms. returns how many frames were written
+int GetFrameTimes(const profiler_t *profiler, float *times, int max);
+
+// writes a chrome://tracing / perfetto trace_event json file
+bool WriteChromeTrace(const profiler_t *profiler, const char *path);
+
+#endif
@@ -0,0 +1,330 @@
+#include "render.h"
+#include "rlgl.h"
+#include <math.h>
+#include <stdlib.h>
+
+const int labelCellWidth = 80;
+const int labelCellHeight = 12;
+const int labelFontSize = 10;
+const int labelAtlasWidth = 2048;
+const int quadsPerChunk = 1024; // quads pushed between batch limit checks
+
+static Texture2D LoadCircleAtlas(Rectangle *sprite)
+{
+    // 32px circle for bullets, so it never gets scaled too far
+    Image image = GenImageColor(32, 32, BLANK);
+    ImageDrawCircleV(&image, (Vector2){16, 16}, 15, WHITE);
+    sprite[spriteSmallCircle] = (Rectangle){1, 1, 30, 30};
+    Texture2D atlas = LoadTextureFromImage(image);
+    SetTextureFilter(atlas, TEXTURE_FILTER_BILINEAR);
+    UnloadImage(image);
+    return atlas;
+}
+
+static bool InitLabelCache(label_cache_t *labels, int capacity)
+{
+    int columns = labelAtlasWidth / labelCellWidth;
+    int rows = (capacity + columns - 1) / columns;
+    *labels = (label_cache_t){
+        .capacity = capacity,
+        .columns = columns,
+        .shown = malloc(capacity * sizeof(handle_t)),
+        .value = calloc(capacity, sizeof(float))};
+    if (labels->shown == NULL || labels->value == NULL)
+        return false;
+    for (int id = 0; id < capacity; id++)
+        labels->shown[id] = (handle_t){.id = -1};
+
+    Image blank = GenImageColor(columns * labelCellWidth, rows * labelCellHeight, BLANK);
+    labels->atlas = LoadTextureFromImage(blank);
+    UnloadImage(blank);
+    labels->scratch = GenImageColor(labelCellWidth, labelCellHeight, BLANK);
+    return true;
+}
+
+static void UnloadLabelCache(label_cache_t *labels)
+{
+    if (labels->atlas.id != 0)
+        UnloadTexture(labels->atlas);
+    if (labels->scratch.data != NULL)
+        UnloadImage(labels->scratch);
+    free(labels->shown);
+    free(labels->value);
+    *labels = (label_cache_t){0};
+}
+
+bool InitRenderer(renderer_t *renderer, int commandCapacity, int labelCapacity)
+{
+    *renderer = (renderer_t){
+        .commands = malloc(commandCapacity * sizeof(render_command_t)),
+        .commandCapacity = commandCapacity};
+    if (renderer->commands == NULL || !InitLabelCache(&renderer->labels, labelCapacity))
+    {
+        UnloadRenderer(renderer);
+        return false;
+    }
+    renderer->atlas = LoadCircleAtlas(renderer->sprite);
+    return true;
+}
+
+void UnloadRenderer(renderer_t *renderer)
+{
+    if (renderer->atlas.id != 0)
+        UnloadTexture(renderer->atlas);
+    UnloadLabelCache(&renderer->labels);
+    free(renderer->commands);
+    *renderer = (renderer_t){0};
+}
+
+static void PushCommand(renderer_t *renderer, float x, float y, float radius, sprite_e sprite, Color color,
+                        const Vector2 *shape)
+{
+    if (renderer->commandCount >= renderer->commandCapacity)
+        return;
+    renderer->commands[renderer->commandCount++] = (render_command_t){x, y, radius, sprite, color, shape};
+}
+
+// whether a circle reaches into view
+static bool InView(Rectangle view, float x, float y, float radius)
+{
+    return x + radius >= view.x && x - radius <= view.x + view.width &&
+           y + radius >= view.y && y - radius <= view.y + view.height;
+}
+
+// where an entity is drawn between its previous and latest tick
+static Vector2 DrawnAt(const entity_array_t *entities, int i, float alpha)
+{
+    float x = entities->previousX[i] + (entities->x[i] - entities->previousX[i]) * alpha;
+    float y = entities->previousY[i] + (entities->y[i] - entities->previousY[i]) * alpha;
+    return (Vector2){x, y};
+}
+
+void BuildRenderList(renderer_t *renderer, const world_t *world, Rectangle view, float alpha)
+{
+    renderer->commandCount = 0;
+    renderer->outlineStart = 0;
+    renderer->stats = (render_stats_t){0};
+    if (world->state != gameStatePlaying)
+        return;
+
+    const entity_array_t *bullet = &world->bullet;
+    for (int i = 0; i < bullet->pool.count; i++)
+    {
+        Vector2 at = DrawnAt(bullet, i, alpha);
+        if (InView(view, at.x, at.y, bullet->radius[i]))
+            PushCommand(renderer, at.x, at.y, bullet->radius[i], spriteSmallCircle, BLUE, NULL);
+    }
+
+    // the corners were made when each asteroid spawned, nothing is generated here
+    renderer->outlineStart = renderer->commandCount;
+    const entity_array_t *asteroid = &world->asteroid;
+    for (int i = 0; i < asteroid->pool.count; i++)
+    {
+        Vector2 at = DrawnAt(asteroid, i, alpha);
+        if (InView(view, at.x, at.y, asteroid->radius[i]))
+            PushCommand(renderer, at.x, at.y, asteroid->radius[i], spriteOutline, BROWN,
+                        &world->asteroidShape[asteroid->pool.idOf[i] * ASTEROID_VERTICES]);
+    }
+}
+
+// pushes an axis aligned textured quad, caller has already opened RL_QUADS
+static void PushQuad(Texture2D texture, Rectangle source, float x, float y, float width, float height, Color color)
+{
+    float u0 = source.x / texture.width;
+    float v0 = source.y / texture.height;
+    float u1 = (source.x + source.width) / texture.width;
+    float v1 = (source.y + source.height) / texture.height;
+
+    rlColor4ub(color.r, color.g, color.b, color.a);
+    rlTexCoord2f(u0, v0);
+    rlVertex2f(x, y);
+    rlTexCoord2f(u0, v1);
+    rlVertex2f(x, y + height);
+    rlTexCoord2f(u1, v1);
+    rlVertex2f(x + width, y + height);
+    rlTexCoord2f(u1, v0);
+    rlVertex2f(x + width, y);
+}
+
+// every pass starts and ends with a flush of its own, so a batch never mixes the pass with other geometry and the
+// flushes counted are exactly the batches the renderer handed to the gpu. rlgl only flushes inside a pass when
+// rlCheckRenderBatchLimit runs out of room, which is counted too
+static void BeginPass(renderer_t *renderer)
+{
+    rlDrawRenderBatchActive(); // the player, text or anything else drawn before this pass
+    renderer->unflushed = 0;
+}
+
+static void EndPass(renderer_t *renderer)
+{
+    rlDrawRenderBatchActive();
+    if (renderer->unflushed > 0)
+        renderer->stats.drawCalls++;
+    renderer->unflushed = 0;
+}
+
+// makes room for vertices more, counting the flush when rlgl had to make it
+static void ReserveVertices(renderer_t *renderer, int vertices)
+{
+    if (rlCheckRenderBatchLimit(vertices) && renderer->unflushed > 0)
+    {
+        renderer->stats.drawCalls++;
+        renderer->unflushed = 0;
+    }
+}
+
+static void Pushed(renderer_t *renderer, int vertices)
+{
+    renderer->stats.vertices += vertices;
+    renderer->unflushed += vertices;
+}
+
+// starts a chunk of at most quads quads
+static void BeginQuadChunk(renderer_t *renderer, Texture2D texture, int quads)
+{
+    ReserveVertices(renderer, quads * 4);
+    rlSetTexture(texture.id);
+    rlBegin(RL_QUADS);
+    rlNormal3f(0, 0, 1);
+}
+
+static void EndQuadChunk(renderer_t *renderer, int quads)
+{
+    rlEnd();
+    rlSetTexture(0);
+    Pushed(renderer, quads * 4);
+}
+
+static void DrawOutlines(renderer_t *renderer)
+{
+    if (renderer->outlineStart == renderer->commandCount)
+        return;
+    BeginPass(renderer);
+    for (int start = renderer->outlineStart; start < renderer->commandCount; start += quadsPerChunk)
+    {
+        int end = start + quadsPerChunk < renderer->commandCount ? start + quadsPerChunk : renderer->commandCount;
+        int vertices = (end - start) * ASTEROID_VERTICES * 2;
+        ReserveVertices(renderer, vertices);
+        rlBegin(RL_LINES);
+        for (int i = start; i < end; i++)
+        {
+            render_command_t command = renderer->commands[i];
+            rlColor4ub(command.color.r, command.color.g, command.color.b, command.color.a);
+            for (int k = 0; k < ASTEROID_VERTICES; k++)
+            {
+                Vector2 from = command.shape[k];
+                Vector2 to = command.shape[(k + 1) % ASTEROID_VERTICES];
+                rlVertex2f(command.x + from.x, command.y + from.y);
+                rlVertex2f(command.x + to.x, command.y + to.y);
+            }
+        }
+        rlEnd();
+        Pushed(renderer, vertices);
+    }
+    EndPass(renderer);
+}
+
+void DrawRenderList(renderer_t *renderer)
+{
+    DrawOutlines(renderer);
+    if (renderer->outlineStart == 0)
+        return;
+    BeginPass(renderer);
+    for (int start = 0; start < renderer->outlineStart; start += quadsPerChunk)
+    {
+        int end = start + quadsPerChunk < renderer->outlineStart ? start + quadsPerChunk : renderer->outlineStart;
+        BeginQuadChunk(renderer, renderer->atlas, end - start);
+        for (int i = start; i < end; i++)
+        {
+            render_command_t command = renderer->commands[i];
+            PushQuad(renderer->atlas, renderer->sprite[command.sprite],
+                     command.x - command.radius, command.y - command.radius,
+                     command.radius * 2, command.radius * 2, command.color);
+        }
+        EndQuadChunk(renderer, end - start);
+    }
+    EndPass(renderer);
+}
+
+void DrawParticles(renderer_t *renderer, const particle_system_t *particles)
+{
+    if (particles->count == 0)
+        return;
+    BeginPass(renderer);
+    Rectangle source = renderer->sprite[spriteSmallCircle];
+    for (int start = 0; start < particles->count; start += quadsPerChunk)
+    {
+        int end = start + quadsPerChunk < particles->count ? start + quadsPerChunk : particles->count;
+        BeginQuadChunk(renderer, renderer->atlas, end - start);
+        for (int i = start; i < end; i++)
+        {
+            Color color = particles->color[i];
+            color.a = (unsigned char)(color.a * fminf(1, particles->life[i] * particles->fade[i]));
+            float size = particles->size[i];
+            PushQuad(renderer->atlas, source, particles->x[i] - size, particles->y[i] - size, size * 2, size * 2,
+                     color);
+        }
+        EndQuadChunk(renderer, end - start);
+    }
+    EndPass(renderer);
+}
+
+static Rectangle LabelCell(const label_cache_t *labels, int id)
+{
+    return (Rectangle){(float)(id % labels->columns) * labelCellWidth,
+                       (float)(id / labels->columns) * labelCellHeight,
+                       labelCellWidth, labelCellHeight};
+}
+
+// re-rasterizes the cell of the asteroid in slot if it is not what the cell shows
+static void RefreshLabel(renderer_t *renderer, const pool_t *pool, int slot, float value)
+{
+    label_cache_t *labels = &renderer->labels;
+    int id = pool->idOf[slot];
+    // shown[id] keeps resolving for as long as the asteroid it was drawn for holds the id, wherever it moves to
+    if (PoolResolve(pool, labels->shown[id]) != -1 && labels->value[id] == value)
+        return;
+    ImageClearBackground(&labels->scratch, BLANK);
+    ImageDrawText(&labels->scratch, TextFormat("%i-%.2f", id, value), 0, 0, labelFontSize, GREEN);
+    UpdateTextureRec(labels->atlas, LabelCell(labels, id), labels->scratch.data);
+    labels->shown[id] = PoolHandle(pool, slot);
+    labels->value[id] = value;
+    renderer->stats.labelUpdates++;
+}
+
+void DrawAsteroidLabels(renderer_t *renderer, const world_t *world, Rectangle view, float alpha)
+{
+    label_cache_t *labels = &renderer->labels;
+    const entity_array_t *asteroid = &world->asteroid;
+    if (world->state != gameStatePlaying || asteroid->pool.count == 0)
+        return;
+
+    for (int i = 0; i < asteroid->pool.count; i++)
+    {
+        int id = asteroid->pool.idOf[i];
+        Vector2 at = DrawnAt(asteroid, i, alpha);
+        if (id < labels->capacity && InView(view, at.x, at.y, asteroid->radius[i]))
+            RefreshLabel(renderer, &asteroid->pool, i, asteroid->radius[i]);
+    }
+
+    BeginPass(renderer);
+    for (int start = 0; start < asteroid->pool.count; start += quadsPerChunk)
+    {
+        int end = start + quadsPerChunk < asteroid->pool.count ? start + quadsPerChunk : asteroid->pool.count;
+        BeginQuadChunk(renderer, labels->atlas, end - start);
+        int quads = 0;
+        for (int i = start; i < end; i++)
+        {
+            int id = asteroid->pool.idOf[i];
+            if (id >= labels->capacity)
+                continue; // only the first labelCapacity ids get a cell
+            Vector2 at = DrawnAt(asteroid, i, alpha);
+            if (!InView(view, at.x, at.y, asteroid->radius[i]))
+                continue;
+            PushQuad(labels->atlas, LabelCell(labels, id), at.x, at.y, labelCellWidth, labelCellHeight, WHITE);
+            quads++;
+        }
+        EndQuadChunk(renderer, quads);
+    }
+    EndPass(renderer);
+}
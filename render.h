@@ -0,0 +1,73 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "raylib.h"
+#include "game.h"
+#include "particles.h"
+
+typedef enum sprite_e
+{
+    spriteSmallCircle, // bullets
+    spriteOutline,     // asteroids, line loops through their cached corners instead of a texture
+    spriteCount
+} sprite_e;
+
+// one tinted circle sprite or outline, filled from the world before anything is drawn
+typedef struct render_command_t
+{
+    float x;
+    float y;
+    float radius;
+    sprite_e sprite;
+    Color color;
+    const Vector2 *shape; // ASTEROID_VERTICES offsets for spriteOutline, points into the world
+} render_command_t;
+
+typedef struct render_stats_t
+{
+    int drawCalls;    // batches the renderer's own passes flushed to the gpu this frame, text and the player not included
+    int vertices;     // vertices the renderer pushed this frame
+    int labelUpdates; // labels re-rasterized this frame
+} render_stats_t;
+
+// asteroid labels, rasterized into atlas cells keyed by pool id. a cell is only redrawn once the handle it was drawn
+// for goes stale or the value changes, otherwise the label is a single textured quad
+typedef struct label_cache_t
+{
+    Texture2D atlas;
+    Image scratch; // one cell, reused for every redraw
+    int capacity;
+    int columns;
+    handle_t *shown; // per pool id, the asteroid the cell was drawn for. an id of -1 never resolves
+    float *value;
+} label_cache_t;
+
+typedef struct renderer_t
+{
+    Texture2D atlas; // pre-rasterized white circles, tinted per command
+    Rectangle sprite[spriteCount];
+    render_command_t *commands; // sprites first, then outlines from outlineStart on
+    int commandCount;
+    int outlineStart;
+    int commandCapacity;
+    label_cache_t labels;
+    render_stats_t stats;
+    int unflushed; // vertices the current pass pushed since rlgl last flushed
+} renderer_t;
+
+// needs a window. commandCapacity should cover every bullet and asteroid
+bool InitRenderer(renderer_t *renderer, int commandCapacity, int labelCapacity);
+void UnloadRenderer(renderer_t *renderer);
+
+// only what reaches into view, in world coordinates, is drawn. positions are alpha of the way from the previous
+// tick to the latest one
+void BuildRenderList(renderer_t *renderer, const world_t *world, Rectangle view, float alpha);
+// draws the sprites in one textured pass and the outlines in one line pass, call between BeginDrawing and EndDrawing.
+// each pass flushes what rlgl batched before it and its own draws when it ends
+void DrawRenderList(renderer_t *renderer);
+// draws every particle as a quad from the circle atlas in one batch, faded by the life it has left
+void DrawParticles(renderer_t *renderer, const particle_system_t *particles);
+// draws "id-size" next to every asteroid in view from the label cache
+void DrawAsteroidLabels(renderer_t *renderer, const world_t *world, Rectangle view, float alpha);
+
+#endif
@@ -0,0 +1,124 @@
+#include "replay.h"
+#include <math.h>
+#include <string.h>
+
+static const char replayMagic[4] = {'A', 'S', 'T', 'R'};
+// 2: binary angles and table trig, 3: swept collisions, 4: polygon asteroids, 5: chunked fields,
+// 6: counter based rng
+static const uint32_t replayVersion = 6;
+static const long replayTicksOffset = 40; // where the tick count sits in the header
+
+static void WriteU32(FILE *file, uint32_t value)
+{
+    unsigned char bytes[4] = {value, value >> 8, value >> 16, value >> 24};
+    fwrite(bytes, 1, 4, file);
+}
+
+static bool ReadU32(FILE *file, uint32_t *value)
+{
+    unsigned char bytes[4];
+    if (fread(bytes, 1, 4, file) != 4)
+        return false;
+    *value = bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+    return true;
+}
+
+static void WriteF32(FILE *file, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    WriteU32(file, bits);
+}
+
+static bool ReadF32(FILE *file, float *value)
+{
+    uint32_t bits;
+    if (!ReadU32(file, &bits))
+        return false;
+    memcpy(value, &bits, sizeof(bits));
+    return true;
+}
+
+bool OpenReplayForWriting(replay_file_t *replay, const char *path, world_config_t config)
+{
+    *replay = (replay_file_t){.file = fopen(path, "wb"), .writing = true};
+    if (replay->file == NULL)
+        return false;
+    replay->header = (replay_header_t){.config = config};
+
+    fwrite(replayMagic, 1, sizeof(replayMagic), replay->file);
+    WriteU32(replay->file, replayVersion);
+    WriteU32(replay->file, config.seed);
+    WriteF32(replay->file, 1.0f / config.tickRate);
+    WriteU32(replay->file, config.maxBullets);
+    WriteU32(replay->file, config.maxAsteroids);
+    WriteU32(replay->file, config.chunkColumns);
+    WriteU32(replay->file, config.chunkRows);
+    WriteU32(replay->file, config.maxParked);
+    WriteU32(replay->file, config.fieldAsteroids);
+    WriteU32(replay->file, 0); // ticks, patched in CloseReplay
+    return true;
+}
+
+void WriteReplayTick(replay_file_t *replay, unsigned int input, uint32_t hash)
+{
+    fputc(input & 0xff, replay->file);
+    WriteU32(replay->file, hash);
+    replay->ticksDone++;
+}
+
+bool OpenReplayForReading(replay_file_t *replay, const char *path)
+{
+    *replay = (replay_file_t){.file = fopen(path, "rb")};
+    if (replay->file == NULL)
+        return false;
+
+    char magic[4];
+    uint32_t version, seed, maxBullets, maxAsteroids, chunkColumns, chunkRows, maxParked, fieldAsteroids, ticks;
+    float dt;
+    if (fread(magic, 1, sizeof(magic), replay->file) != sizeof(magic) ||
+        memcmp(magic, replayMagic, sizeof(magic)) != 0 ||
+        !ReadU32(replay->file, &version) || version != replayVersion ||
+        !ReadU32(replay->file, &seed) || !ReadF32(replay->file, &dt) ||
+        !ReadU32(replay->file, &maxBullets) || !ReadU32(replay->file, &maxAsteroids) ||
+        !ReadU32(replay->file, &chunkColumns) || !ReadU32(replay->file, &chunkRows) ||
+        !ReadU32(replay->file, &maxParked) || !ReadU32(replay->file, &fieldAsteroids) ||
+        !ReadU32(replay->file, &ticks) || !(dt > 0))
+    {
+        CloseReplay(replay);
+        return false;
+    }
+    replay->header = (replay_header_t){
+        .config = {.maxBullets = maxBullets,
+                   .maxAsteroids = maxAsteroids,
+                   .seed = seed,
+                   .chunkColumns = chunkColumns,
+                   .chunkRows = chunkRows,
+                   .maxParked = maxParked,
+                   .fieldAsteroids = fieldAsteroids,
+                   .tickRate = (int)lroundf(1 / dt)},
+        .ticks = ticks};
+    return true;
+}
+
+bool ReadReplayTick(replay_file_t *replay, unsigned int *input, uint32_t *hash)
+{
+    if (replay->header.ticks != 0 && replay->ticksDone >= replay->header.ticks)
+        return false;
+    int byte = fgetc(replay->file);
+    if (byte == EOF || !ReadU32(replay->file, hash))
+        return false;
+    *input = (unsigned int)byte;
+    replay->ticksDone++;
+    return true;
+}
+
+void CloseReplay(replay_file_t *replay)
+{
+    if (replay->file == NULL)
+        return;
+    if (replay->writing && fseek(replay->file, replayTicksOffset, SEEK_SET) == 0)
+        WriteU32(replay->file, replay->ticksDone);
+    fclose(replay->file);
+    replay->file = NULL;
+}
@@ -0,0 +1,38 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "game.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// replay log, all integers little endian:
+//   "ASTR" | u32 version | u32 seed | f32 dt | u32 maxBullets | u32 maxAsteroids
+//   | u32 chunkColumns | u32 chunkRows | u32 maxParked | u32 fieldAsteroids | u32 ticks
+//   then per tick: u8 input | u32 HashWorld after the tick
+// ticks is patched in on close, a log cut short by a crash is read until the data runs out.
+// dt is the seconds per tick, config.tickRate is read back from it
+typedef struct replay_header_t
+{
+    world_config_t config;
+    uint32_t ticks;
+} replay_header_t;
+
+typedef struct replay_file_t
+{
+    FILE *file;
+    replay_header_t header;
+    uint32_t ticksDone; // written or read so far
+    bool writing;
+} replay_file_t;
+
+bool OpenReplayForWriting(replay_file_t *replay, const char *path, world_config_t config);
+void WriteReplayTick(replay_file_t *replay, unsigned int input, uint32_t hash);
+
+bool OpenReplayForReading(replay_file_t *replay, const char *path);
+// false at the end of the log
+bool ReadReplayTick(replay_file_t *replay, unsigned int *input, uint32_t *hash);
+
+void CloseReplay(replay_file_t *replay);
+
+#endif
@@ -0,0 +1,29 @@
+#include "rng.h"
+
+random_key_t RandomKey(uint32_t seed, random_stream_e stream)
+{
+    return (random_key_t){.seed = seed, .stream = (uint32_t)stream};
+}
+
+random_block_t RandomBlock(random_key_t key, uint32_t id, uint32_t tick, uint32_t draw)
+{
+    uint32_t c0 = id, c1 = tick, c2 = draw, c3 = 0;
+    uint32_t k0 = key.seed, k1 = key.stream;
+    for (int round = 0; round < PHILOX_ROUNDS; round++)
+    {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t)p1;
+        c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    return (random_block_t){{c0, c1, c2, c3}};
+}
+
+float RandomUnit(uint32_t word)
+{
+    return (word >> 8) * (1.0f / (1 << 24));
+}
@@ -0,0 +1,46 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// counter based random numbers (philox 4x32-10). a block is a pure function of its key and counter, there is no
+// state to share or advance, so the numbers for any entity at any tick can be drawn on any thread, in any order,
+// or drawn again later and come out the same
+
+// multipliers and key increments from the philox paper (salmon et al., "parallel random numbers: as easy as 1, 2, 3"),
+// shared with FillRandomBlocks
+#define PHILOX_M0 0xd2511f53u
+#define PHILOX_M1 0xcd9e8d57u
+#define PHILOX_W0 0x9e3779b9u
+#define PHILOX_W1 0xbb67ae85u
+#define PHILOX_ROUNDS 10
+
+// every subsystem gets its own stream, so drawing more in one never shifts another
+typedef enum random_stream_e
+{
+    randomStreamAsteroidSpawn,
+    randomStreamField,
+    randomStreamParticles,
+    randomStreamActions,
+    randomStreamBench
+} random_stream_e;
+
+typedef struct random_key_t
+{
+    uint32_t seed;
+    uint32_t stream;
+} random_key_t;
+
+// four independent uniformly distributed words
+typedef struct random_block_t
+{
+    uint32_t word[4];
+} random_block_t;
+
+random_key_t RandomKey(uint32_t seed, random_stream_e stream);
+// the block for entity id at tick. draw picks another block when one is not enough
+random_block_t RandomBlock(random_key_t key, uint32_t id, uint32_t tick, uint32_t draw);
+// 0 to 1, excluding 1, from the top 24 bits of a word
+float RandomUnit(uint32_t word);
+
+#endif
@@ -0,0 +1,494 @@
+// authoritative game server: every client that connects gets its own world, and all of them are stepped
+// on one epoll loop per thread. clients send inputs, the server answers every tick with a snapshot of what
+// is near their view, delta coded against the newest snapshot they acknowledged
+// usage: ./server [--port n] [--threads n] [--hz n] [--seconds n] [--report n] [--max-sessions n]
+// --threads runs that many loops on SO_REUSEPORT sockets, the kernel keeps each client on the same one
+// --hz is the tick rate, from minTickRate up. a lower one costs less and plays the same game in coarser steps
+// --seconds 0 runs until killed, --report prints stats every n seconds
+#define _GNU_SOURCE
+#include "game.h"
+#include "net.h"
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SERVER_BATCH 64 // datagrams per recvmmsg / sendmmsg
+
+const double sessionTimeout = 5; // seconds without a packet before a session is dropped
+const int respawnTicks = 120;    // a dead player's world restarts after this long
+const int maxCatchUpTicks = 4;   // ticks run for one timer wakeup when the loop fell behind
+
+typedef struct session_t
+{
+    struct sockaddr_in address;
+    world_t *world;
+    net_input_t input; // newest received
+    bool hasInput;
+    uint16_t sequence;         // of the next snapshot
+    snapshot_record_t *sent;   // NET_BASELINES, what each recent snapshot told the client
+    double lastHeard;
+    int deadTicks;
+} session_t;
+
+typedef struct outbox_t
+{
+    int count;
+    struct mmsghdr messages[SERVER_BATCH];
+    struct iovec parts[SERVER_BATCH];
+    struct sockaddr_in to[SERVER_BATCH];
+    uint8_t data[SERVER_BATCH][NET_MAX_PACKET];
+} outbox_t;
+
+typedef struct server_loop_t
+{
+    pthread_t thread;
+    int socket;
+    int epoll;
+    int timer;
+    int tickRate;
+    long tick;
+
+    session_t *sessions;
+    int sessionCount;
+    int maxSessions;
+    int *table; // open addressing from client address to session index + 1, 0 is empty
+    int tableSize;
+    net_candidate_t *candidates;
+    outbox_t *outbox;
+    uint8_t (*inbox)[NET_MAX_PACKET]; // SERVER_BATCH datagrams
+
+    // read by the reporting thread
+    atomic_long bytesIn;
+    atomic_long bytesOut;
+    atomic_long busyNanoseconds;
+    atomic_long ticks;
+    atomic_long sessionTicks; // sessions summed over ticks, averages stay right while clients come and go
+    atomic_int liveSessions;
+} server_loop_t;
+
+static atomic_bool running = true;
+static atomic_uint nextSeed = 1;
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned int HashAddress(const struct sockaddr_in *address)
+{
+    return (address->sin_addr.s_addr * 2654435761u) ^ (address->sin_port * 40503u);
+}
+
+static bool SameAddress(const struct sockaddr_in *a, const struct sockaddr_in *b)
+{
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+static session_t *FindSession(server_loop_t *loop, const struct sockaddr_in *address)
+{
+    for (unsigned int i = HashAddress(address);; i++)
+    {
+        int entry = loop->table[i & (loop->tableSize - 1)];
+        if (entry == 0)
+            return NULL;
+        if (SameAddress(&loop->sessions[entry - 1].address, address))
+            return &loop->sessions[entry - 1];
+    }
+}
+
+static void InsertIntoTable(server_loop_t *loop, int index)
+{
+    unsigned int i = HashAddress(&loop->sessions[index].address);
+    while (loop->table[i & (loop->tableSize - 1)] != 0)
+        i++;
+    loop->table[i & (loop->tableSize - 1)] = index + 1;
+}
+
+static session_t *CreateSession(server_loop_t *loop, const struct sockaddr_in *address, double now)
+{
+    if (loop->sessionCount == loop->maxSessions)
+        return NULL;
+    world_config_t config = DefaultWorldConfig();
+    config.seed = atomic_fetch_add(&nextSeed, 1);
+    config.tickRate = loop->tickRate;
+    session_t session = {.address = *address,
+                         .world = CreateWorld(config),
+                         .sent = calloc(NET_BASELINES, sizeof(snapshot_record_t)),
+                         .lastHeard = now};
+    if (session.world == NULL || session.sent == NULL)
+    {
+        DestroyWorld(session.world);
+        free(session.sent);
+        return NULL;
+    }
+    int index = loop->sessionCount++;
+    loop->sessions[index] = session;
+    InsertIntoTable(loop, index);
+    atomic_store(&loop->liveSessions, loop->sessionCount);
+    return &loop->sessions[index];
+}
+
+static void RemoveSession(server_loop_t *loop, int index)
+{
+    DestroyWorld(loop->sessions[index].world);
+    free(loop->sessions[index].sent);
+    loop->sessions[index] = loop->sessions[--loop->sessionCount];
+    // removals are rare, rebuilding beats tombstones
+    memset(loop->table, 0, loop->tableSize * sizeof(int));
+    for (int i = 0; i < loop->sessionCount; i++)
+        InsertIntoTable(loop, i);
+    atomic_store(&loop->liveSessions, loop->sessionCount);
+}
+
+static uint8_t *QueuePacket(server_loop_t *loop, const struct sockaddr_in *to)
+{
+    outbox_t *outbox = loop->outbox;
+    outbox->to[outbox->count] = *to;
+    return outbox->data[outbox->count];
+}
+
+static void FlushOutbox(server_loop_t *loop)
+{
+    outbox_t *outbox = loop->outbox;
+    int sent = 0;
+    while (sent < outbox->count)
+    {
+        int done = sendmmsg(loop->socket, outbox->messages + sent, outbox->count - sent, 0);
+        if (done <= 0)
+            break; // the socket buffer is full, dropping is what udp would do anyway
+        for (int i = sent; i < sent + done; i++)
+            atomic_fetch_add(&loop->bytesOut, outbox->messages[i].msg_len);
+        sent += done;
+    }
+    outbox->count = 0;
+}
+
+static void SendQueued(server_loop_t *loop, size_t size)
+{
+    outbox_t *outbox = loop->outbox;
+    int i = outbox->count++;
+    outbox->parts[i] = (struct iovec){.iov_base = outbox->data[i], .iov_len = size};
+    outbox->messages[i] = (struct mmsghdr){.msg_hdr = {.msg_name = &outbox->to[i],
+                                                       .msg_namelen = sizeof(outbox->to[i]),
+                                                       .msg_iov = &outbox->parts[i],
+                                                       .msg_iovlen = 1}};
+    if (outbox->count == SERVER_BATCH)
+        FlushOutbox(loop);
+}
+
+static void HandlePacket(server_loop_t *loop, const struct sockaddr_in *from, const uint8_t *data, size_t size, double now)
+{
+    session_t *session = FindSession(loop, from);
+    switch (PacketType(data, size))
+    {
+    case packetConnect:
+        if (!ReadConnectPacket(data, size))
+            break;
+        if (session == NULL)
+            session = CreateSession(loop, from, now);
+        if (session != NULL) // the welcome is resent for every connect in case one was lost
+            SendQueued(loop, WriteWelcomePacket(QueuePacket(loop, from), session->world->config, loop->tickRate));
+        break;
+    case packetInput:
+    {
+        net_input_t input;
+        if (session == NULL || !ReadInputPacket(data, size, &input))
+            break;
+        if (!session->hasInput || SequenceNewer(input.sequence, session->input.sequence))
+        {
+            session->input = input;
+            session->hasInput = true;
+        }
+        session->lastHeard = now;
+        break;
+    }
+    case packetDisconnect:
+        if (session != NULL)
+            RemoveSession(loop, session - loop->sessions);
+        break;
+    default:
+        break;
+    }
+}
+
+static void ReceivePackets(server_loop_t *loop, double now)
+{
+    struct mmsghdr messages[SERVER_BATCH];
+    struct iovec parts[SERVER_BATCH];
+    struct sockaddr_in from[SERVER_BATCH];
+    uint8_t (*data)[NET_MAX_PACKET] = loop->inbox;
+    int received;
+    do
+    {
+        for (int i = 0; i < SERVER_BATCH; i++)
+        {
+            parts[i] = (struct iovec){.iov_base = data[i], .iov_len = NET_MAX_PACKET};
+            messages[i] = (struct mmsghdr){.msg_hdr = {.msg_name = &from[i],
+                                                       .msg_namelen = sizeof(from[i]),
+                                                       .msg_iov = &parts[i],
+                                                       .msg_iovlen = 1}};
+        }
+        received = recvmmsg(loop->socket, messages, SERVER_BATCH, MSG_DONTWAIT, NULL);
+        for (int i = 0; i < received; i++)
+        {
+            atomic_fetch_add(&loop->bytesIn, messages[i].msg_len);
+            HandlePacket(loop, &from[i], data[i], messages[i].msg_len, now);
+        }
+    } while (received == SERVER_BATCH);
+    FlushOutbox(loop);
+}
+
+static void TickSession(server_loop_t *loop, session_t *session)
+{
+    world_t *world = session->world;
+    StepWorld(world, session->hasInput ? session->input.input : 0);
+    if (world->state == gameStateDead && ++session->deadTicks >= respawnTicks)
+    {
+        InitGame(world);
+        session->deadTicks = 0;
+    }
+
+    const snapshot_record_t *baseline = NULL;
+    if (session->hasInput && session->input.hasAck)
+    {
+        uint16_t ack = session->input.ack;
+        const snapshot_record_t *candidate = &session->sent[ack % NET_BASELINES];
+        if (candidate->valid && candidate->sequence == ack && (uint16_t)(session->sequence - ack) < NET_BASELINES)
+            baseline = candidate;
+    }
+
+    Rectangle view = {0, 0, screenWidth, screenHeight};
+    if (session->hasInput)
+        view = session->input.view;
+    snapshot_record_t *record = &session->sent[session->sequence % NET_BASELINES];
+    BuildSnapshotRecord(world, view, baseline, loop->candidates, record);
+    record->sequence = session->sequence++;
+    record->tick = (uint32_t)loop->tick;
+    record->valid = true;
+    SendQueued(loop, WriteSnapshotPacket(QueuePacket(loop, &session->address), record, baseline));
+}
+
+static void TickSessions(server_loop_t *loop, double now)
+{
+    for (int i = loop->sessionCount - 1; i >= 0; i--)
+    {
+        if (now - loop->sessions[i].lastHeard > sessionTimeout)
+            RemoveSession(loop, i);
+    }
+    for (int i = 0; i < loop->sessionCount; i++)
+        TickSession(loop, &loop->sessions[i]);
+    FlushOutbox(loop);
+    loop->tick++;
+    atomic_fetch_add(&loop->ticks, 1);
+    atomic_fetch_add(&loop->sessionTicks, loop->sessionCount);
+}
+
+static void *RunServerLoop(void *context)
+{
+    server_loop_t *loop = context;
+    struct epoll_event events[2];
+    while (atomic_load(&running))
+    {
+        int count = epoll_wait(loop->epoll, events, 2, 100);
+        double start = Now();
+        for (int i = 0; i < count; i++)
+        {
+            if (events[i].data.fd == loop->socket)
+            {
+                ReceivePackets(loop, start);
+            }
+            else
+            {
+                uint64_t expirations = 0;
+                if (read(loop->timer, &expirations, sizeof(expirations)) != sizeof(expirations))
+                    continue;
+                for (uint64_t k = 0; k < expirations && k < (uint64_t)maxCatchUpTicks; k++)
+                    TickSessions(loop, start);
+            }
+        }
+        atomic_fetch_add(&loop->busyNanoseconds, (long)((Now() - start) * 1e9));
+    }
+    return NULL;
+}
+
+static bool OpenServerLoop(server_loop_t *loop, int port, int tickRate, int maxSessions)
+{
+    world_config_t config = DefaultWorldConfig();
+    loop->tickRate = tickRate;
+    loop->maxSessions = maxSessions;
+    loop->tableSize = 1;
+    while (loop->tableSize < maxSessions * 2)
+        loop->tableSize *= 2;
+    loop->sessions = calloc(maxSessions, sizeof(session_t));
+    loop->table = calloc(loop->tableSize, sizeof(int));
+    loop->candidates = malloc((config.maxBullets + config.maxAsteroids) * sizeof(net_candidate_t));
+    loop->outbox = calloc(1, sizeof(outbox_t));
+    loop->inbox = calloc(SERVER_BATCH, NET_MAX_PACKET);
+    if (loop->sessions == NULL || loop->table == NULL || loop->candidates == NULL || loop->outbox == NULL ||
+        loop->inbox == NULL)
+        return false;
+
+    loop->socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    int on = 1;
+    setsockopt(loop->socket, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+    int bufferSize = 4 << 20;
+    setsockopt(loop->socket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    setsockopt(loop->socket, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY)};
+    if (loop->socket == -1 || bind(loop->socket, (struct sockaddr *)&address, sizeof(address)) != 0)
+        return false;
+
+    loop->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    long period = 1000000000L / tickRate;
+    struct itimerspec interval = {.it_interval = {period / 1000000000L, period % 1000000000L},
+                                  .it_value = {period / 1000000000L, period % 1000000000L}};
+    loop->epoll = epoll_create1(0);
+    if (loop->timer == -1 || loop->epoll == -1 || timerfd_settime(loop->timer, 0, &interval, NULL) != 0)
+        return false;
+    struct epoll_event socketEvent = {.events = EPOLLIN, .data.fd = loop->socket};
+    struct epoll_event timerEvent = {.events = EPOLLIN, .data.fd = loop->timer};
+    return epoll_ctl(loop->epoll, EPOLL_CTL_ADD, loop->socket, &socketEvent) == 0 &&
+           epoll_ctl(loop->epoll, EPOLL_CTL_ADD, loop->timer, &timerEvent) == 0;
+}
+
+static void CloseServerLoop(server_loop_t *loop)
+{
+    for (int i = 0; i < loop->sessionCount; i++)
+    {
+        DestroyWorld(loop->sessions[i].world);
+        free(loop->sessions[i].sent);
+    }
+    free(loop->sessions);
+    free(loop->table);
+    free(loop->candidates);
+    free(loop->outbox);
+    free(loop->inbox);
+    close(loop->socket);
+    close(loop->timer);
+    close(loop->epoll);
+}
+
+typedef struct server_totals_t
+{
+    long bytesIn;
+    long bytesOut;
+    long busyNanoseconds;
+    long ticks;
+    long sessionTicks;
+    int sessions;
+} server_totals_t;
+
+static server_totals_t SumLoops(server_loop_t *loops, int count)
+{
+    server_totals_t totals = {0};
+    for (int i = 0; i < count; i++)
+    {
+        totals.bytesIn += atomic_load(&loops[i].bytesIn);
+        totals.bytesOut += atomic_load(&loops[i].bytesOut);
+        totals.busyNanoseconds += atomic_load(&loops[i].busyNanoseconds);
+        totals.ticks += atomic_load(&loops[i].ticks);
+        totals.sessionTicks += atomic_load(&loops[i].sessionTicks);
+        totals.sessions += atomic_load(&loops[i].liveSessions);
+    }
+    return totals;
+}
+
+// sessions per core is how many sessions one fully busy core would hold at the cost measured so far
+static void PrintReport(server_totals_t now, server_totals_t before, double seconds, int threads)
+{
+    double busy = (now.busyNanoseconds - before.busyNanoseconds) / (seconds * 1e9);
+    long ticks = now.ticks - before.ticks;
+    double sessions = ticks > 0 ? (double)(now.sessionTicks - before.sessionTicks) * threads / ticks : 0;
+    printf("sessions %i (%.0f avg) | ticks/s %.0f | busy %.1f%% of one core over %i threads | sessions/core %.0f | per client in %.0f B/s, out %.0f B/s\n",
+           now.sessions, sessions, ticks / seconds / threads, busy * 100, threads,
+           busy > 0 ? sessions / busy : 0,
+           sessions > 0 ? (now.bytesIn - before.bytesIn) / seconds / sessions : 0,
+           sessions > 0 ? (now.bytesOut - before.bytesOut) / seconds / sessions : 0);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    int port = defaultServerPort;
+    int threads = 1;
+    int tickRate = 60;
+    double seconds = 0;
+    double reportEvery = 5;
+    int maxSessions = 4096;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--port") == 0)
+            port = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--threads") == 0)
+            threads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--hz") == 0)
+            tickRate = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seconds") == 0)
+            seconds = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--report") == 0)
+            reportEvery = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--max-sessions") == 0)
+            maxSessions = atoi(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (threads < 1 || tickRate < minTickRate || tickRate > 255 || maxSessions < 1 || reportEvery <= 0)
+    {
+        fprintf(stderr, "--threads, --hz (up to 255), --max-sessions and --report must be positive\n");
+        return 1;
+    }
+
+    server_loop_t *loops = calloc(threads, sizeof(server_loop_t));
+    for (int i = 0; i < threads; i++)
+    {
+        if (!OpenServerLoop(&loops[i], port, tickRate, maxSessions))
+        {
+            fprintf(stderr, "failed to open server loop %i on port %i\n", i, port);
+            return 1;
+        }
+    }
+    for (int i = 0; i < threads; i++)
+        pthread_create(&loops[i].thread, NULL, RunServerLoop, &loops[i]);
+    printf("listening on udp port %i, %i thread(s) at %i hz\n", port, threads, tickRate);
+    fflush(stdout);
+
+    double start = Now();
+    double lastReport = start;
+    server_totals_t previous = SumLoops(loops, threads);
+    server_totals_t first = previous;
+    while (seconds <= 0 || Now() - start < seconds)
+    {
+        usleep(100000);
+        double now = Now();
+        if (now - lastReport >= reportEvery)
+        {
+            server_totals_t totals = SumLoops(loops, threads);
+            PrintReport(totals, previous, now - lastReport, threads);
+            previous = totals;
+            lastReport = now;
+        }
+    }
+    atomic_store(&running, false);
+    for (int i = 0; i < threads; i++)
+        pthread_join(loops[i].thread, NULL);
+
+    printf("overall: ");
+    PrintReport(SumLoops(loops, threads), first, Now() - start, threads);
+    for (int i = 0; i < threads; i++)
+        CloseServerLoop(&loops[i]);
+    free(loops);
+    return 0;
+}
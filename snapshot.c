@@ -0,0 +1,147 @@
+#include "snapshot.h"
+#include <stdlib.h>
+#include <string.h>
+
+// a delta is a list of [zero words][literal words][literals...] runs covering the whole frame.
+// one that would not come out smaller is stored as the raw xor, marked by storedBytes == frameBytes
+
+static size_t EncodeDelta(const uint32_t *a, const uint32_t *b, size_t words, uint32_t *out)
+{
+    size_t limit = words; // give up once the encoding is no smaller than the raw xor
+    size_t used = 0;
+    size_t i = 0;
+    while (i < words)
+    {
+        size_t zeros = 0;
+        while (i + zeros < words && a[i + zeros] == b[i + zeros])
+            zeros++;
+        i += zeros;
+        size_t literals = 0;
+        while (i + literals < words && a[i + literals] != b[i + literals])
+            literals++;
+        if (used + 2 + literals >= limit)
+        {
+            for (size_t k = 0; k < words; k++)
+                out[k] = a[k] ^ b[k];
+            return words;
+        }
+        out[used++] = (uint32_t)zeros;
+        out[used++] = (uint32_t)literals;
+        for (size_t k = 0; k < literals; k++)
+            out[used++] = a[i + k] ^ b[i + k];
+        i += literals;
+    }
+    return used;
+}
+
+// xors the delta into frame in place, turning one side of it into the other
+static void ApplyDelta(uint32_t *frame, const uint32_t *delta, size_t deltaWords, size_t words)
+{
+    if (deltaWords == words)
+    {
+        for (size_t k = 0; k < words; k++)
+            frame[k] ^= delta[k];
+        return;
+    }
+    size_t i = 0;
+    size_t used = 0;
+    while (used < deltaWords)
+    {
+        i += delta[used++];
+        uint32_t literals = delta[used++];
+        for (uint32_t k = 0; k < literals; k++)
+            frame[i++] ^= delta[used++];
+    }
+}
+
+static uint32_t *Slot(const snapshot_ring_t *ring, int index)
+{
+    return ring->frames + (size_t)index * (ring->frameBytes / sizeof(uint32_t));
+}
+
+bool InitSnapshotRing(snapshot_ring_t *ring, const world_t *world, int capacity, bool delta)
+{
+    *ring = (snapshot_ring_t){
+        .frameBytes = world->stateBytes,
+        .capacity = capacity,
+        .newest = capacity - 1,
+        .delta = delta,
+        .frames = malloc((size_t)capacity * world->stateBytes),
+        .storedBytes = calloc(capacity, sizeof(size_t))};
+    if (delta)
+        ring->newestFull = malloc(world->stateBytes);
+    if (ring->frames == NULL || ring->storedBytes == NULL || (delta && ring->newestFull == NULL))
+    {
+        FreeSnapshotRing(ring);
+        return false;
+    }
+    return true;
+}
+
+void FreeSnapshotRing(snapshot_ring_t *ring)
+{
+    free(ring->frames);
+    free(ring->storedBytes);
+    free(ring->newestFull);
+    *ring = (snapshot_ring_t){0};
+}
+
+void PushSnapshot(snapshot_ring_t *ring, const world_t *world)
+{
+    size_t words = ring->frameBytes / sizeof(uint32_t);
+    int previous = ring->newest;
+    ring->newest = (ring->newest + 1) % ring->capacity;
+    if (ring->count < ring->capacity)
+        ring->count++;
+
+    if (!ring->delta)
+    {
+        memcpy(Slot(ring, ring->newest), world, ring->frameBytes);
+        ring->storedBytes[ring->newest] = ring->frameBytes;
+        return;
+    }
+
+    // the old newest frame becomes a delta against the new one, the new one is only kept decoded
+    const uint32_t *current = (const uint32_t *)world;
+    if (ring->count > 1)
+        ring->storedBytes[previous] = EncodeDelta(ring->newestFull, current, words, Slot(ring, previous)) * sizeof(uint32_t);
+    memcpy(ring->newestFull, current, ring->frameBytes);
+    ring->storedBytes[ring->newest] = 0;
+}
+
+bool RestoreSnapshot(snapshot_ring_t *ring, world_t *world, int back)
+{
+    if (back < 0 || back >= ring->count || world->stateBytes != ring->frameBytes)
+        return false;
+    size_t words = ring->frameBytes / sizeof(uint32_t);
+    int target = (ring->newest - back + ring->capacity) % ring->capacity;
+
+    if (!ring->delta)
+    {
+        RestoreWorldState(world, Slot(ring, target));
+    }
+    else
+    {
+        // walk back from the newest frame one delta at a time
+        for (int k = 1; k <= back; k++)
+        {
+            int slot = (ring->newest - k + ring->capacity) % ring->capacity;
+            ApplyDelta(ring->newestFull, Slot(ring, slot), ring->storedBytes[slot] / sizeof(uint32_t), words);
+        }
+        ring->storedBytes[target] = 0;
+        RestoreWorldState(world, ring->newestFull);
+    }
+    ring->newest = target;
+    ring->count -= back;
+    return true;
+}
+
+size_t SnapshotRingBytes(const snapshot_ring_t *ring)
+{
+    size_t bytes = 0;
+    for (int k = 0; k < ring->count; k++)
+        bytes += ring->storedBytes[(ring->newest - k + ring->capacity) % ring->capacity];
+    if (ring->delta && ring->count > 0)
+        bytes += ring->frameBytes; // the decoded newest frame
+    return bytes;
+}
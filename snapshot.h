@@ -0,0 +1,35 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "game.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// the last N world states, for rollback and save states. everything is allocated up front.
+// with delta on, only the newest frame is kept whole and every older one is stored as the xor against
+// the frame after it with runs of zero words squeezed out, which is most of it since little changes per tick
+typedef struct snapshot_ring_t
+{
+    size_t frameBytes; // world stateBytes, a multiple of 4
+    int capacity;      // frames
+    int count;         // frames held, the newest is (newest), older ones sit behind it
+    int newest;
+    bool delta;
+    uint32_t *frames;     // capacity slots of frameBytes each
+    size_t *storedBytes;  // bytes used in each slot, smaller than frameBytes once compressed
+    uint32_t *newestFull; // the newest frame decoded, delta mode only
+} snapshot_ring_t;
+
+bool InitSnapshotRing(snapshot_ring_t *ring, const world_t *world, int capacity, bool delta);
+void FreeSnapshotRing(snapshot_ring_t *ring);
+
+// records the world as the newest frame, dropping the oldest once full
+void PushSnapshot(snapshot_ring_t *ring, const world_t *world);
+// puts the world back to the frame back pushes ago (0 is the newest) and forgets every frame after it,
+// so pushing again continues from there. false if the ring does not reach that far
+bool RestoreSnapshot(snapshot_ring_t *ring, world_t *world, int back);
+// bytes the held frames take up, for comparing against count * frameBytes
+size_t SnapshotRingBytes(const snapshot_ring_t *ring);
+
+#endif
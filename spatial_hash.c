@@ -0,0 +1,62 @@
+#include "spatial_hash.h"
+#include <math.h>
+#include <string.h>
+
+void PlaceSpatialHash(spatial_hash_t *hash, float cellSize, Vector2 min, Vector2 max, int capacity, arena_t *arena)
+{
+    *hash = (spatial_hash_t){
+        .cellSize = cellSize,
+        .originX = min.x,
+        .originY = min.y,
+        .columns = (int)ceilf((max.x - min.x) / cellSize),
+        .rows = (int)ceilf((max.y - min.y) / cellSize),
+        .capacity = capacity};
+    if (hash->columns < 1)
+        hash->columns = 1;
+    if (hash->rows < 1)
+        hash->rows = 1;
+
+    hash->cellStart = ArenaTake(arena, (hash->columns * hash->rows + 1) * sizeof(int));
+    hash->cellItems = ArenaTake(arena, capacity * sizeof(int));
+    hash->itemCell = ArenaTake(arena, capacity * sizeof(int));
+}
+
+void MoveSpatialHash(spatial_hash_t *hash, Vector2 min)
+{
+    hash->originX = min.x;
+    hash->originY = min.y;
+}
+
+void SpatialHashCellOf(const spatial_hash_t *hash, Vector2 position, int *column, int *row)
+{
+    // clamping never moves two points further apart than a cell, so neighbour queries stay exact
+    int x = (int)floorf((position.x - hash->originX) / hash->cellSize);
+    int y = (int)floorf((position.y - hash->originY) / hash->cellSize);
+    *column = x < 0 ? 0 : (x >= hash->columns ? hash->columns - 1 : x);
+    *row = y < 0 ? 0 : (y >= hash->rows ? hash->rows - 1 : y);
+}
+
+void SpatialHashSetItem(spatial_hash_t *hash, int item, Vector2 position)
+{
+    int column, row;
+    SpatialHashCellOf(hash, position, &column, &row);
+    hash->itemCell[item] = row * hash->columns + column;
+}
+
+void FinishSpatialHash(spatial_hash_t *hash, int itemCount)
+{
+    int cells = hash->columns * hash->rows;
+    memset(hash->cellStart, 0, (cells + 1) * sizeof(int));
+    hash->itemCount = itemCount;
+    for (int item = 0; item < itemCount; item++)
+        hash->cellStart[hash->itemCell[item] + 1]++;
+    for (int i = 0; i < cells; i++)
+        hash->cellStart[i + 1] += hash->cellStart[i];
+
+    // scatter using cellStart as a running cursor, then shift it back into place
+    for (int item = 0; item < itemCount; item++)
+        hash->cellItems[hash->cellStart[hash->itemCell[item]]++] = item;
+    for (int i = cells; i > 0; i--)
+        hash->cellStart[i] = hash->cellStart[i - 1];
+    hash->cellStart[0] = 0;
+}
@@ -0,0 +1,39 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include "raylib.h"
+#include "arena.h"
+#include <stdbool.h>
+
+// uniform grid rebuilt from scratch every tick with a counting sort.
+// items in a cell stay in ascending item order, so walking a cell
+// visits them in the same order as a brute-force loop would.
+typedef struct spatial_hash_t
+{
+    float cellSize;
+    float originX;
+    float originY;
+    int columns;
+    int rows;
+    int capacity;  // max items per build
+    int itemCount;
+    int *cellStart; // columns * rows + 1 offsets into cellItems
+    int *cellItems; // item ids grouped by cell
+    int *itemCell;  // cell of every inserted item, used while building
+} spatial_hash_t;
+
+// covers the rectangle min..max, points outside it are clamped into the border cells.
+// the arrays are taken from the arena, which only needs to outlive the hash
+void PlaceSpatialHash(spatial_hash_t *hash, float cellSize, Vector2 min, Vector2 max, int capacity, arena_t *arena);
+// slides the covered rectangle so it starts at min, keeping its size. call before setting items
+void MoveSpatialHash(spatial_hash_t *hash, Vector2 min);
+
+// records which cell an item falls in. items are numbered 0..itemCount-1 and each one must be
+// set before FinishSpatialHash. different items may be set from different threads
+void SpatialHashSetItem(spatial_hash_t *hash, int item, Vector2 position);
+// sorts items 0..itemCount-1 into their cells, replacing whatever was there before
+void FinishSpatialHash(spatial_hash_t *hash, int itemCount);
+
+void SpatialHashCellOf(const spatial_hash_t *hash, Vector2 position, int *column, int *row);
+
+#endif
@@ -0,0 +1,83 @@
+#include "trig.h"
+#include <pthread.h>
+
+#define SIN_TABLE_BITS 10
+#define SIN_TABLE_SIZE (1 << SIN_TABLE_BITS)
+
+const int sinFractionBits = 32 - SIN_TABLE_BITS;
+const double radiansPerTurn = 6.283185307179586;
+const double anglePerRadian = 683565275.5764316; // 2^32 / 2pi
+
+static float sinTable[SIN_TABLE_SIZE + 1]; // one extra so interpolation never wraps
+static pthread_once_t sinTableOnce = PTHREAD_ONCE_INIT;
+
+// taylor series on 0..pi/2, built from correctly rounded double ops so it does not depend on libm
+static double QuarterSin(double x)
+{
+    double x2 = x * x;
+    double term = x;
+    double sum = x;
+    for (int n = 1; n <= 7; n++)
+    {
+        term = -term * x2 / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+static void BuildSinTable(void)
+{
+    int quarter = SIN_TABLE_SIZE / 4;
+    for (int i = 0; i <= quarter; i++)
+    {
+        float value = (float)QuarterSin(i * radiansPerTurn / SIN_TABLE_SIZE);
+        // mirror the first quarter so the table is exactly symmetric
+        sinTable[i] = value;
+        sinTable[2 * quarter - i] = value;
+        sinTable[2 * quarter + i] = -value;
+        sinTable[SIN_TABLE_SIZE - i] = -value;
+    }
+    sinTable[quarter] = 1;
+    sinTable[3 * quarter] = -1;
+    sinTable[0] = 0;
+    sinTable[2 * quarter] = 0;
+    sinTable[SIN_TABLE_SIZE] = 0;
+}
+
+void InitTrig(void)
+{
+    pthread_once(&sinTableOnce, BuildSinTable);
+}
+
+float AngleSin(angle_t angle)
+{
+    uint32_t index = angle >> sinFractionBits;
+    // the fraction has fewer bits than a float mantissa and the scale is a power of two, so both steps are exact
+    float fraction = (float)(angle & ((1u << sinFractionBits) - 1)) * (1.0f / (1u << sinFractionBits));
+    float a = sinTable[index];
+    float b = sinTable[index + 1];
+    return a + (b - a) * fraction;
+}
+
+float AngleCos(angle_t angle)
+{
+    return AngleSin(angle + QUARTER_TURN);
+}
+
+angle_t AngleFromRadians(double radians)
+{
+    // through int64 so negative angles wrap instead of being undefined
+    return (angle_t)(int64_t)(radians * anglePerRadian);
+}
+
+double AngleToRadians(angle_t angle)
+{
+    return angle * (radiansPerTurn / 4294967296.0);
+}
+
+Vector2 PolarOffset(Vector2 origin, float length, angle_t angle)
+{
+    float dx = length * AngleCos(angle);
+    float dy = length * AngleSin(angle);
+    return (Vector2){origin.x + dx, origin.y + dy};
+}
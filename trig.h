@@ -0,0 +1,29 @@
+#ifndef TRIG_H
+#define TRIG_H
+
+#include "raylib.h"
+#include <stdint.h>
+
+// binary angle, a full turn is 2^32 so adding and subtracting wrap around on their own
+typedef uint32_t angle_t;
+
+#define QUARTER_TURN ((angle_t)1 << 30)
+#define HALF_TURN ((angle_t)1 << 31)
+#define THIRD_TURN ((angle_t)1431655765) // 2^32 / 3, rounded down
+
+// builds the sine table, safe to call more than once and from several threads
+void InitTrig(void);
+
+// table lookups with linear interpolation, only plain float adds and multiplies so every
+// build gives the same bits as long as it is compiled with -ffp-contract=off
+float AngleSin(angle_t angle);
+float AngleCos(angle_t angle);
+
+// for setup and display, not for the simulation's per tick math
+angle_t AngleFromRadians(double radians);
+double AngleToRadians(angle_t angle);
+
+// origin + length * (cos, sin), the multiply and add always happen in that order
+Vector2 PolarOffset(Vector2 origin, float length, angle_t angle);
+
+#endif